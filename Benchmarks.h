@@ -0,0 +1,1290 @@
+//
+//  Benchmarks.h
+//
+//  3/26/14.
+//
+//
+//  Synthetic benchmarks for the per-frame data paths.
+//  Results go to the log, run them from a release build.
+//  Utils.h has to be included before this file.
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxTween.h"
+#include "GeoGrid.h"
+#include "CityPointStore.h"
+#include "CityDataFile.h"
+#include "MapPixelBatch.h"
+#include "MapPixelCurves.h"
+#include "MapPixelKernel.h"
+#include "ScreenGrid.h"
+#include "VisibleSet.h"
+#include "ColorPyramid.h"
+#include "StreetViewFetcher.h"
+#include "StreetViewImageStore.h"
+#include "StreetViewAtlas.h"
+#include "KdTree.h"
+#include "TripleBuffer.h"
+#include "LockFreeQueue.h"
+#include "LeapSimpleHands.h"
+#include "LeapRecording.h"
+#include "FramePipeline.h"
+#include "TaskPool.h"
+
+namespace Benchmarks {
+
+    // Uniformly scattered points over a city sized square around lat, lon
+    inline void randomCity( vector<float> &latitude, vector<float> &longitude, size_t count,
+                            double lat, double lon, double extent )
+    {
+        latitude.resize( count );
+        longitude.resize( count );
+        for (size_t i = 0; i < count; i++)
+        {
+            latitude[i]  = lat + ofRandom( -extent, extent );
+            longitude[i] = lon + ofRandom( -extent, extent );
+        }
+    }
+
+    // Linear scan of every coordinate against the grid window query
+    inline void cullingGridVsScan( double latRange, double lonRange )
+    {
+        const size_t sizes[] = { 10000, 1000000, 10000000 };
+        const int    queries = 100;
+
+        for (int s = 0; s < 3; s++)
+        {
+            vector<float> latitude, longitude;
+            randomCity( latitude, longitude, sizes[s], 37.77, -122.42, 0.5 );
+
+            vector<float> centerLat, centerLon;
+            randomCity( centerLat, centerLon, queries, 37.77, -122.42, 0.5 );
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            GeoGrid grid;
+            grid.build( latitude, longitude );
+            uint64_t buildTime = ofGetElapsedTimeMicros() - start;
+
+            // linear scan, the pre-grid update() path
+            size_t scanHits = 0;
+            start = ofGetElapsedTimeMicros();
+            for (int q = 0; q < queries; q++)
+            {
+                double cx = centerLat[q];
+                double cy = centerLon[q];
+
+                for (size_t i = 0; i < latitude.size(); i++)
+                {
+                    double x = latitude[i];
+                    double y = longitude[i];
+
+                    if ( x <  cx + latRange && y <  cy + lonRange &&
+                         x >= cx - latRange && y >= cy - lonRange )
+                        scanHits++;
+                }
+            }
+            uint64_t scanTime = ofGetElapsedTimeMicros() - start;
+
+            size_t gridHits = 0;
+            vector<int> ids;
+            start = ofGetElapsedTimeMicros();
+            for (int q = 0; q < queries; q++)
+            {
+                ids.clear();
+                grid.query( centerLat[q] - latRange, centerLat[q] + latRange,
+                            centerLon[q] - lonRange, centerLon[q] + lonRange, ids );
+                gridHits += ids.size();
+            }
+            uint64_t gridTime = ofGetElapsedTimeMicros() - start;
+
+            ofLogNotice("Benchmarks") << "culling " << sizes[s] << " points: "
+                                      << "scan " << scanTime / queries << "us/query, "
+                                      << "grid " << gridTime / queries << "us/query, "
+                                      << "build " << buildTime / 1000 << "ms, "
+                                      << grid.getNumCells() << " cells"
+                                      << ( scanHits == gridHits ? "" : " - HIT COUNT MISMATCH" );
+        }
+    }
+
+    // Cold start of the point data, text files against the binary file
+    inline void startupTextVsBinary( string cityFile, string elevationFile, string binaryFile )
+    {
+        uint64_t start = ofGetElapsedTimeMicros();
+        CityPointStore textPoints;
+        GeoGrid        textGrid;
+        Utils::loadColors( textPoints, cityFile );
+        Utils::loadElevations( textPoints, elevationFile );
+        textGrid.build( textPoints.latitude, textPoints.longitude );
+        uint64_t textTime = ofGetElapsedTimeMicros() - start;
+
+        start = ofGetElapsedTimeMicros();
+        CityPointStore binaryPoints;
+        GeoGrid        binaryGrid;
+        bool loaded = CityDataFile::load( binaryPoints, binaryGrid, binaryFile );
+        uint64_t binaryTime = ofGetElapsedTimeMicros() - start;
+
+        if ( !loaded )
+        {
+            ofLogWarning("Benchmarks") << "startup: no " << binaryFile << ", run tools/cityDataConverter first";
+            return;
+        }
+
+        ofLogNotice("Benchmarks") << "startup " << textPoints.size() << " points: "
+                                  << "text " << textTime / 1000 << "ms, "
+                                  << "binary " << binaryTime / 1000 << "ms"
+                                  << ( textPoints.size() == binaryPoints.size() ? "" : " - POINT COUNT MISMATCH" );
+    }
+
+    // CPU side of the batched map pixel renderer, no GL involved - the
+    // records and the bytes draw() uploads for them
+    inline void mapPixelFill()
+    {
+        const size_t sizes[] = { 1000, 10000, 100000 };
+        const int    frames  = 20;
+
+        for (int s = 0; s < 3; s++)
+        {
+            MapPixelBatch batch;
+            uint64_t start = ofGetElapsedTimeMicros();
+
+            for (int f = 0; f < frames; f++)
+            {
+                batch.clear();
+                for (size_t i = 0; i < sizes[s]; i++)
+                {
+                    batch.add( ofRandom( 800 ), ofRandom( 800 ), ofRandom( -15, 65 ), ofRandom( -1, 4.5 ),
+                               ofColor( ofRandom( 255 ), ofRandom( 255 ), ofRandom( 255 ) ), ofRandom( 180 ) );
+                }
+            }
+
+            uint64_t elapsed = std::max( (uint64_t)1, ofGetElapsedTimeMicros() - start );
+            ofLogNotice("Benchmarks") << "map pixel fill " << sizes[s] << " pixels: "
+                                      << elapsed / frames << "us/frame, "
+                                      << uint64_t( sizes[s] * frames * 1000000.0 / elapsed ) << " pixels/s, "
+                                      << batch.getNumBytes() / 1024 << "KB uploaded";
+        }
+    }
+
+    // Random projected pixels around a map center at 0, 0
+    inline void randomPixels( MapPixelAttributes &pixels, size_t count )
+    {
+        pixels.resize( count );
+        for (size_t i = 0; i < count; i++)
+        {
+            pixels.x[i]         = ofRandom( -300, 300 );
+            pixels.y[i]         = ofRandom( -300, 300 );
+            pixels.elevation[i] = ofRandom( -20, 300 );
+        }
+    }
+
+    // MapPixelCurves checked against the six ofxTween::map calls it replaces,
+    // then both timed per point
+    inline void mapPixelCurves( ofxEasing &easing, ofxTween::ofxEasingType type )
+    {
+        const size_t count = 100000;
+
+        MapPixelAttributes pixels;
+        randomPixels( pixels, count );
+
+        uint64_t start = ofGetElapsedTimeMicros();
+        MapPixelKernel::compute( pixels, 0, 0, MapPixelKernel::ISA_SCALAR );
+        uint64_t curveTime = ofGetElapsedTimeMicros() - start;
+
+        float maxError = 0;
+        start = ofGetElapsedTimeMicros();
+        for (size_t i = 0; i < count; i++)
+        {
+            float dist = ofDist( 0, 0, pixels.x[i], pixels.y[i] );
+            float elev = pixels.elevation[i];
+
+            float alpha     = ofxTween::map(dist, 40, 280, 180, 0, true, easing, type);
+            float radius    = ofxTween::map(dist, 40, 280, 4.5, 0.5, true, easing, type);
+            float height    = ofxTween::map(dist, 40, 280, 15, 0, true, easing, type);
+            float alpha2    = ofxTween::map(dist, 70, 280, 255, 0, true, easing, type);
+            float elevation = ofxTween::map(elev, 0, 280, -15, 50, true, easing, type);
+            float h_radius  = ofxTween::map(elev, 0, 280, 0, -1.5, true, easing, type);
+
+            maxError = std::max( maxError, fabsf( alpha  - pixels.alpha[i] ) );
+            maxError = std::max( maxError, fabsf( alpha2 - pixels.labelAlpha[i] ) );
+            maxError = std::max( maxError, fabsf( radius + h_radius  - pixels.radius[i] ) );
+            maxError = std::max( maxError, fabsf( height + elevation - pixels.z[i] ) );
+        }
+        uint64_t tweenTime = ofGetElapsedTimeMicros() - start;
+
+        ofLogNotice("Benchmarks") << "map pixel curves " << count << " points: "
+                                  << "ofxTween " << tweenTime * 1000 / count << "ns/point, "
+                                  << "curves " << curveTime * 1000 / count << "ns/point, "
+                                  << "max error " << maxError
+                                  << ( maxError < 0.01f ? "" : " - CURVES DO NOT MATCH OFXTWEEN" );
+    }
+
+    // Attribute kernel per instruction set, checked against the scalar version
+    inline void mapPixelKernels()
+    {
+        const size_t count  = 10000;
+        const int    frames = 200;
+
+        MapPixelAttributes scalar;
+        randomPixels( scalar, count );
+        MapPixelKernel::compute( scalar, 0, 0, MapPixelKernel::ISA_SCALAR );
+
+        const MapPixelKernel::Isa isas[] = { MapPixelKernel::ISA_SCALAR,
+                                             MapPixelKernel::ISA_SSE2,
+                                             MapPixelKernel::ISA_AVX2 };
+        for (int k = 0; k < 3; k++)
+        {
+            if ( !MapPixelKernel::isSupported( isas[k] ) )
+            {
+                ofLogNotice("Benchmarks") << "map pixel kernel " << MapPixelKernel::getIsaName( isas[k] ) << ": not supported";
+                continue;
+            }
+
+            MapPixelAttributes pixels = scalar;
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            for (int f = 0; f < frames; f++)
+                MapPixelKernel::compute( pixels, 0, 0, isas[k] );
+            uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+
+            float maxError = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                maxError = std::max( maxError, fabsf( pixels.alpha[i]      - scalar.alpha[i] ) );
+                maxError = std::max( maxError, fabsf( pixels.radius[i]     - scalar.radius[i] ) );
+                maxError = std::max( maxError, fabsf( pixels.z[i]          - scalar.z[i] ) );
+                maxError = std::max( maxError, fabsf( pixels.labelAlpha[i] - scalar.labelAlpha[i] ) );
+            }
+
+            ofLogNotice("Benchmarks") << "map pixel kernel " << MapPixelKernel::getIsaName( isas[k] ) << ": "
+                                      << elapsed * 1000.0 / ( (double)count * frames ) << "ns/point, "
+                                      << "max error " << maxError;
+        }
+    }
+
+    // Finger hit test over the visible set, scan against the screen grid.
+    // Ten fingers per frame, cost per query as the visible set grows.
+    inline void fingerHitTest()
+    {
+        const size_t sizes[]  = { 1000, 10000, 100000 };
+        const int    frames   = 100;
+        const int    fingers  = 10;
+
+        for (int s = 0; s < 3; s++)
+        {
+            MapPixelAttributes pixels;
+            randomPixels( pixels, sizes[s] );
+
+            vector<ofPoint> queries;
+            for (int q = 0; q < frames * fingers; q++)
+                queries.push_back( ofPoint( ofRandom( -300, 300 ), ofRandom( -300, 300 ) ) );
+
+            // linear scan, the pre-grid draw() path
+            vector<int> scanHits( queries.size() );
+            uint64_t start = ofGetElapsedTimeMicros();
+            for (size_t q = 0; q < queries.size(); q++)
+            {
+                int hit = -1;
+                for (size_t i = 0; i < sizes[s]; i++)
+                {
+                    if ( ofDist( pixels.x[i], pixels.y[i], queries[q].x, queries[q].y ) <= 7 )
+                        hit = i;
+                }
+                scanHits[q] = hit;
+            }
+            uint64_t scanTime = ofGetElapsedTimeMicros() - start;
+
+            // grid rebuilt every frame like in update()
+            ScreenGrid grid;
+            size_t tested     = 0;
+            size_t mismatches = 0;
+            uint64_t buildTime = 0;
+            start = ofGetElapsedTimeMicros();
+            for (int f = 0; f < frames; f++)
+            {
+                uint64_t buildStart = ofGetElapsedTimeMicros();
+                grid.build( pixels.x.data(), pixels.y.data(), sizes[s] );
+                buildTime += ofGetElapsedTimeMicros() - buildStart;
+
+                for (int k = 0; k < fingers; k++)
+                {
+                    int q = f * fingers + k;
+                    if ( grid.findLast( queries[q].x, queries[q].y, 7 ) != scanHits[q] )
+                        mismatches++;
+                }
+                tested += grid.getNumTested();
+            }
+            uint64_t gridTime = ofGetElapsedTimeMicros() - start;
+
+            ofLogNotice("Benchmarks") << "finger hit test " << sizes[s] << " visible: "
+                                      << "scan " << scanTime * 1000 / queries.size() << "ns/query, "
+                                      << "grid " << ( gridTime - buildTime ) * 1000 / queries.size() << "ns/query, "
+                                      << tested / queries.size() << " points tested/query, "
+                                      << "build " << buildTime / frames << "us/frame"
+                                      << ( mismatches == 0 ? "" : " - HIT MISMATCH" );
+        }
+    }
+
+    // Projection of a fixed zoom map centered on lat, lon, like update() fits it
+    inline void calibrateProjector( MercatorProjector &projector, double lat, double lon )
+    {
+        const double step   = 0.01;
+        const double scaleX = 60000;    // pixels per degree, about zoom 17
+        const double scaleY = -scaleX * RAD_TO_DEG;
+
+        ofPoint center( 400, 400 );
+        projector.calibrate( lat, lon, step, center,
+                             ofPoint( 400, 400 + scaleY * ( MercatorProjector::toMercatorY( lat + step ) -
+                                                            MercatorProjector::toMercatorY( lat ) ) ),
+                             ofPoint( 400 + scaleX * step, 400 ) );
+    }
+
+    // Panning at navigation speed, incremental visible set against a rebuild every frame
+    inline void visibleSetPanning( double latRange, double lonRange )
+    {
+        const size_t count  = 1000000;
+        const int    frames = 600;
+
+        CityPointStore points;
+        vector<float> latitude, longitude;
+        randomCity( latitude, longitude, count, 37.77, -122.42, 0.1 );
+        points.reserve( count );
+        for (size_t i = 0; i < count; i++)
+            points.addPoint( latitude[i], longitude[i], 0, 0 );
+
+        GeoGrid grid;
+        grid.build( points.latitude, points.longitude );
+
+        VisibleSet incremental, rebuilt;
+        MercatorProjector projector;
+        uint64_t incrementalTime = 0, rebuildTime = 0;
+        size_t   rebuilds = 0, mismatches = 0;
+        float    maxError = 0;
+
+        double lat = 37.77, lon = -122.42;
+        for (int f = 0; f < frames; f++)
+        {
+            // mouse navigation moves by up to MOVEMENT per axis and frame
+            lat += ofRandom( -0.0001, 0.0001 );
+            lon += ofRandom( -0.0001, 0.0001 );
+            calibrateProjector( projector, lat, lon );
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            incremental.update( grid, points, projector, lat, lon, latRange, lonRange );
+            incrementalTime += ofGetElapsedTimeMicros() - start;
+            rebuilds += incremental.wasRebuilt();
+
+            start = ofGetElapsedTimeMicros();
+            rebuilt.invalidate();
+            rebuilt.update( grid, points, projector, lat, lon, latRange, lonRange );
+            rebuildTime += ofGetElapsedTimeMicros() - start;
+
+            // same points, positions within the translation drift
+            map<int, size_t> slots;
+            for (size_t i = 0; i < rebuilt.size(); i++)
+                slots[ rebuilt.ids[i] ] = i;
+
+            if ( slots.size() != incremental.size() )
+                mismatches++;
+
+            for (size_t i = 0; i < incremental.size(); i++)
+            {
+                map<int, size_t>::iterator it = slots.find( incremental.ids[i] );
+                if ( it == slots.end() )
+                {
+                    mismatches++;
+                    continue;
+                }
+                maxError = std::max( maxError, fabsf( incremental.pixels.x[i] + incremental.offset.x - rebuilt.pixels.x[it->second] ) );
+                maxError = std::max( maxError, fabsf( incremental.pixels.y[i] + incremental.offset.y - rebuilt.pixels.y[it->second] ) );
+            }
+        }
+
+        ofLogNotice("Benchmarks") << "visible set panning " << rebuilt.size() << " visible: "
+                                  << "rebuild " << rebuildTime / frames << "us/frame, "
+                                  << "incremental " << incrementalTime / frames << "us/frame, "
+                                  << rebuilds << " rebuilds, "
+                                  << "max drift " << maxError << "px"
+                                  << ( mismatches == 0 ? "" : " - VISIBLE SET MISMATCH" );
+    }
+
+    // Visible set and attribute cost per frame while zooming out, raw points
+    // at viewZoom and the pyramid levels below it
+    inline void colorPyramidZoom( double latRange, double lonRange, int viewZoom, int minZoom )
+    {
+        const size_t count  = 1000000;
+        const int    frames = 20;
+
+        CityPointStore points;
+        vector<float> latitude, longitude;
+        randomCity( latitude, longitude, count, 37.77, -122.42, 0.5 );
+        points.reserve( count );
+        for (size_t i = 0; i < count; i++)
+            points.addPoint( latitude[i], longitude[i], points.intern( "street" ), points.intern( "city" ) );
+        points.displayColor.resize( count );
+        points.cacheColor.resize( count );
+
+        GeoGrid grid;
+        grid.build( points.latitude, points.longitude );
+
+        uint64_t start = ofGetElapsedTimeMicros();
+        ColorPyramid pyramid;
+        pyramid.build( points, 0.0005, viewZoom - minZoom );
+        uint64_t buildTime = ofGetElapsedTimeMicros() - start;
+
+        ofLogNotice("Benchmarks") << "color pyramid " << count << " points: build " << buildTime / 1000 << "ms";
+
+        for (int zoom = viewZoom; zoom >= minZoom; zoom--)
+        {
+            double viewScale = pow( 2.0, viewZoom - zoom );
+            int    level     = std::min( viewZoom - zoom - 1, pyramid.getNumLevels() - 1 );
+
+            const CityPointStore &viewPoints = level < 0 ? points : pyramid.getCells( level );
+            const GeoGrid        &viewGrid   = level < 0 ? grid   : pyramid.getGrid( level );
+
+            MercatorProjector projector;
+            calibrateProjector( projector, 37.77, -122.42 );
+
+            VisibleSet visible;
+            start = ofGetElapsedTimeMicros();
+            for (int f = 0; f < frames; f++)
+            {
+                visible.invalidate();
+                visible.update( viewGrid, viewPoints, projector, 37.77, -122.42,
+                                latRange * viewScale, lonRange * viewScale );
+                MapPixelKernel::compute( visible.pixels, 400, 400 );
+            }
+            uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+
+            ofLogNotice("Benchmarks") << "zoom " << zoom << ( level < 0 ? " points" : " level " + ofToString( level ) ) << ": "
+                                      << visible.size() << " visible, "
+                                      << elapsed / frames << "us/frame";
+        }
+    }
+
+    // Ten fingers drifting over the map against a street view server, main
+    // thread cost per frame and how long until every finger has an image.
+    // Meant for tools/streetViewStandIn, not the real API.
+    inline void streetViewSession( string baseUrl, StreetViewCache *cache, string name )
+    {
+        const int fingers = 10;
+        const int frames  = 300;
+
+        StreetViewFetcher fetcher;
+        fetcher.setup( baseUrl, "benchmark", 4, cache );
+
+        uint64_t mainTime  = 0;
+        uint64_t start     = ofGetElapsedTimeMicros();
+        uint64_t firstFull = 0;
+        bool     allServed = false;
+
+        for (int f = 0; f < frames; f++)
+        {
+            uint64_t frameStart = ofGetElapsedTimeMicros();
+
+            fetcher.update();
+            int ready = 0;
+            for (int k = 0; k < fingers; k++)
+            {
+                // two fingers on the same spot, all moving about one quantum every 5 frames
+                fetcher.request( k, 37.77 + ( k / 2 ) * 0.001 + f * 0.00002, -122.42 );
+                ready += fetcher.get( k ) != NULL;
+            }
+
+            mainTime += ofGetElapsedTimeMicros() - frameStart;
+            if ( ready == fingers && !allServed )
+            {
+                firstFull = ofGetElapsedTimeMicros() - start;
+                allServed = true;
+            }
+
+            // 60 fps
+            std::this_thread::sleep_for( std::chrono::milliseconds( 16 ) );
+        }
+
+        fetcher.stop();
+
+        ofLogNotice("Benchmarks") << "street view " << name << ": "
+                                  << mainTime / frames << "us/frame on the main thread, "
+                                  << ( allServed ? "all fingers served after " + ofToString( firstFull / 1000 ) + "ms, "
+                                                 : string( "some fingers never served, " ) )
+                                  << fetcher.getNumRequested() << " requested, "
+                                  << fetcher.getNumCoalesced() << " coalesced, "
+                                  << fetcher.getNumCancelled() << " cancelled, "
+                                  << fetcher.getNumFetched() << " fetched in "
+                                  << fetcher.getAverageFetchTime() / 1000 << "ms, "
+                                  << fetcher.getNumFailed() << " failed, "
+                                  << fetcher.getNumRetried() << " retried";
+    }
+
+    // Without cache, then a cold and a warm session on an empty cache folder
+    inline void streetViewFetch( string baseUrl )
+    {
+        const string directory = "streetViewBenchmarkCache";
+        ofDirectory::removeDirectory( directory, true );
+
+        streetViewSession( baseUrl, NULL, "no cache" );
+
+        for (int session = 0; session < 2; session++)
+        {
+            // a new cache each time, the second one only has the files of the first
+            StreetViewCache cache;
+            cache.setup( directory, STREETVIEW_SIZE, 1 << 20, 16 << 20 );
+
+            streetViewSession( baseUrl, &cache, session == 0 ? "cold cache" : "warm cache" );
+
+            ofLogNotice("Benchmarks") << "street view cache: "
+                                      << cache.getNumMemoryHits() << " memory hits, "
+                                      << cache.getNumDiskHits() << " disk hits, "
+                                      << cache.getNumMisses() << " misses, "
+                                      << cache.getAverageHitTime() << "us/hit, "
+                                      << cache.getNumEvictions() << " evictions, "
+                                      << cache.getDiskBytes() / 1024 << "KB on disk";
+        }
+
+        ofDirectory::removeDirectory( directory, true );
+    }
+
+    // Offline street views, every image decoded twice and kept resident like
+    // the old loader, against the lazy store - startup time and decoded bytes,
+    // then ten fingers walking over the points at 60fps
+    inline void streetViewImageStore( string cityFile, size_t memoryBudget )
+    {
+        CityPointStore points;
+        Utils::loadColors( points, cityFile );
+
+        // eager
+        uint64_t start = ofGetElapsedTimeMicros();
+        size_t eagerBytes = 0;
+        size_t eagerCount = 0;
+        {
+            ofBuffer file = ofBufferFromFile( cityFile );
+            const char *text = file.getBinaryBuffer();
+
+            vector<CsvRow> rows;
+            CsvIngest::parse( file, rows, cityFile );
+
+            vector<ofPixels> images;
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                if ( rows[i].fieldCount < 2 )
+                    continue;
+
+                string path = "streetViewMap_" + string( text + rows[i].fieldStart[0], rows[i].fieldLength[0] )
+                            + "_" + string( text + rows[i].fieldStart[1], rows[i].fieldLength[1] );
+
+                ofPixels color, kept;
+                ofLoadImage( color, path );
+                ofLoadImage( kept, path );
+                eagerBytes += (size_t)kept.getWidth() * kept.getHeight() * kept.getNumChannels();
+                images.push_back( kept );
+                eagerCount++;
+            }
+        }
+        uint64_t eagerTime = ofGetElapsedTimeMicros() - start;
+
+        // lazy
+        start = ofGetElapsedTimeMicros();
+        StreetViewImageStore store;
+        Utils::loadImages( points, store, cityFile );
+        uint64_t lazyTime = ofGetElapsedTimeMicros() - start;
+
+        if ( store.getNumImages() == 0 )
+        {
+            ofLogWarning("Benchmarks") << "street view images: none found for " << cityFile;
+            return;
+        }
+
+        ofLogNotice("Benchmarks") << "street view images startup, " << eagerCount << " images: "
+                                  << "eager " << eagerTime / 1000 << "ms " << eagerBytes / 1024 << "KB, "
+                                  << "lazy " << lazyTime / 1000 << "ms 0KB";
+
+        // fingers start on random points with an image and walk north
+        store.setup( memoryBudget );
+
+        KdTree tree;
+        GeoGrid grid;
+        tree.build( points.latitude, points.longitude );
+        grid.build( points.latitude, points.longitude );
+
+        const int fingers = 10;
+        const int frames  = 300;
+
+        vector<float> lat( fingers ), lon( fingers );
+        vector<int>   ids( fingers ), prefetch;
+        for (int k = 0; k < fingers; k++)
+        {
+            int id;
+            do { id = ofRandom( points.size() ); } while ( !store.hasImage( id ) );
+            lat[k] = points.latitude[id];
+            lon[k] = points.longitude[id];
+        }
+
+        size_t   shown = 0, wanted = 0, peakBytes = 0;
+        uint64_t mainTime = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            uint64_t frameStart = ofGetElapsedTimeMicros();
+
+            store.update();
+            tree.nearest( lat.data(), lon.data(), fingers, ids.data() );
+
+            prefetch = ids;
+            for (int k = 0; k < fingers; k++)
+                grid.query( lat[k] - 0.0008, lat[k] + 0.0008, lon[k] - 0.001, lon[k] + 0.001, prefetch );
+            store.prefetch( prefetch );
+
+            for (int k = 0; k < fingers; k++)
+            {
+                if ( !store.hasImage( ids[k] ) )
+                    continue;
+                wanted++;
+                shown += store.get( ids[k] ) != NULL;
+            }
+
+            mainTime += ofGetElapsedTimeMicros() - frameStart;
+            peakBytes = std::max( peakBytes, store.getMemoryBytes() );
+
+            for (int k = 0; k < fingers; k++)
+                lat[k] += 0.00002;
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( 16 ) );
+        }
+
+        store.stop();
+
+        ofLogNotice("Benchmarks") << "street view images walk: "
+                                  << mainTime / frames << "us/frame on the main thread, "
+                                  << ( wanted ? 100 * shown / wanted : 100 ) << "% of matches shown, "
+                                  << store.getNumDecoded() << " decoded, "
+                                  << store.getNumEvictions() << " evicted, "
+                                  << peakBytes / 1024 << "KB peak of " << memoryBudget / 1024 << "KB";
+    }
+
+    // Offline street views from the image files against the atlas - startup,
+    // then thumbnails of random points read the way draw() gets them
+    inline void streetViewAtlas( string cityFile, string atlasFile )
+    {
+        CityPointStore filePoints, atlasPoints;
+        Utils::loadColors( filePoints, cityFile );
+        Utils::loadColors( atlasPoints, cityFile );
+
+        uint64_t start = ofGetElapsedTimeMicros();
+        StreetViewImageStore store;
+        Utils::loadImages( filePoints, store, cityFile );
+        uint64_t fileTime = ofGetElapsedTimeMicros() - start;
+
+        start = ofGetElapsedTimeMicros();
+        StreetViewAtlas atlas;
+        bool loaded = atlas.load( atlasPoints, atlasFile );
+        uint64_t atlasTime = ofGetElapsedTimeMicros() - start;
+
+        if ( !loaded )
+        {
+            ofLogWarning("Benchmarks") << "street view atlas: no " << atlasFile << ", run tools/streetViewPacker first";
+            return;
+        }
+
+        int mismatches = 0;
+        vector<int> ids;
+        for (size_t i = 0; i < atlasPoints.size(); i++)
+        {
+            if ( !atlas.hasThumbnail( i ) )
+                continue;
+            ids.push_back( i );
+            mismatches += atlasPoints.color[i] != filePoints.color[i];
+        }
+
+        ofLogNotice("Benchmarks") << "street view startup, " << store.getNumImages() << " image files, "
+                                  << ids.size() << " thumbnails: "
+                                  << "files " << fileTime / 1000 << "ms, "
+                                  << "atlas " << atlasTime / 1000 << "ms"
+                                  << ( mismatches ? " - " + ofToString( mismatches ) + " COLOR MISMATCHES" : string() );
+
+        if ( ids.empty() )
+            return;
+
+        // a decode per file against a read of the mapping, 200 random points
+        const int reads = 200;
+        for (size_t i = ids.size() - 1; i > 0; i--)
+            std::swap( ids[i], ids[ (size_t)ofRandom( i + 1 ) % ( i + 1 ) ] );
+        ids.resize( std::min( (int)ids.size(), reads ) );
+
+        start = ofGetElapsedTimeMicros();
+        ofPixels pixels;
+        for (size_t i = 0; i < ids.size(); i++)
+            ofLoadImage( pixels, store.getPath( ids[i] ) );
+        uint64_t decodeTime = ofGetElapsedTimeMicros() - start;
+
+        start = ofGetElapsedTimeMicros();
+        size_t checksum = 0;
+        size_t bytes    = (size_t)atlas.getThumbnailSize() * atlas.getThumbnailSize() * 3;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            const unsigned char *thumbnail = atlas.getThumbnail( ids[i] );
+            for (size_t b = 0; b < bytes; b += 64)
+                checksum += thumbnail[b];
+        }
+        uint64_t mapTime = ofGetElapsedTimeMicros() - start;
+
+        ofLogNotice("Benchmarks") << "street view thumbnails: "
+                                  << "file decode " << (double)decodeTime / ids.size() << "us, "
+                                  << "atlas " << (double)mapTime / ids.size() << "us per image"
+                                  << " (" << checksum % 10 << ")";
+    }
+
+    // Hand handoff from a 120Hz producer thread to a 60fps reader, the old
+    // mutex and copy against the triple buffer. The producer holds the lock
+    // for the whole frame read like the old onFrameInternal, the reader
+    // reports what a frame costs it and the worst wait.
+    inline void handHandoff()
+    {
+        const int frames = 120;
+        const int points = 64;      // two hands of five fingers and then some
+        const std::chrono::microseconds frameRead( 500 );
+
+        for (int lockFree = 0; lockFree < 2; lockFree++)
+        {
+            std::mutex                    mutex;
+            vector<ofVec3f>               shared;
+            TripleBuffer< vector<ofVec3f> > buffer;
+            std::atomic<bool>             running( true );
+
+            std::thread producer( [&]()
+            {
+                for (int frame = 0; running; frame++)
+                {
+                    if ( lockFree )
+                    {
+                        vector<ofVec3f> &back = buffer.getBack();
+                        back.assign( points, ofVec3f( frame ) );
+                        std::this_thread::sleep_for( frameRead );
+                        buffer.publish();
+                    }
+                    else
+                    {
+                        std::lock_guard<std::mutex> lock( mutex );
+                        shared.assign( points, ofVec3f( frame ) );
+                        std::this_thread::sleep_for( frameRead );
+                    }
+                    std::this_thread::sleep_for( std::chrono::microseconds( 8333 ) );
+                }
+            } );
+
+            uint64_t total = 0, worst = 0;
+            float    check = 0;
+            for (int f = 0; f < frames; f++)
+            {
+                uint64_t start = ofGetElapsedTimeMicros();
+                if ( lockFree )
+                {
+                    buffer.update();
+                    const vector<ofVec3f> &hands = buffer.getFront();
+                    check += hands.empty() ? 0 : hands[0].x;
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock( mutex );
+                    vector<ofVec3f> hands = shared;
+                    check += hands.empty() ? 0 : hands[0].x;
+                }
+                uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+                total += elapsed;
+                worst  = std::max( worst, elapsed );
+
+                std::this_thread::sleep_for( std::chrono::milliseconds( 16 ) );
+            }
+
+            running = false;
+            producer.join();
+
+            ofLogNotice("Benchmarks") << "hand handoff " << ( lockFree ? "triple buffer: " : "mutex and copy: " )
+                                      << (double)total / frames << "us/frame, worst "
+                                      << worst << "us" << ( check < 0 ? " " : "" );
+        }
+    }
+
+    // Heap allocations so far, counted by a global operator new that bumps it.
+    // Only tools/colorWorldHeadless.cpp has one, elsewhere it stays 0.
+    inline std::atomic<size_t>& heapAllocations()
+    {
+        static std::atomic<size_t> count( 0 );
+        return count;
+    }
+
+    // Whether operator new is counted in this build
+    inline bool isCountingHeap()
+    {
+        // called directly, a new expression may be left out by the compiler
+        size_t before = heapAllocations();
+        ::operator delete( ::operator new( 1 ) );
+        return heapAllocations() != before;
+    }
+
+    // Counts the heap allocations of the containers using it
+    template <class T>
+    struct CountingAllocator : std::allocator<T>
+    {
+        template <class U> struct rebind { typedef CountingAllocator<U> other; };
+
+        CountingAllocator() {}
+        template <class U> CountingAllocator( const CountingAllocator<U>& ) {}
+
+        static size_t& count()
+            { static size_t allocations = 0; return allocations; }
+
+        T* allocate( size_t n )
+        {
+            count()++;
+            return std::allocator<T>::allocate( n );
+        }
+    };
+
+    // Simple hands per frame the old way, a new vector of hands each with a
+    // vector of fingers, against the fixed capacity hands filled in place
+    // the way ofxLeapMotion::getSimpleHands() does, and a real
+    // getSimpleHands() - LeapReplay's, over a recording of the same two
+    // hands of five fingers, so no device is needed. The heap allocations
+    // of the fixed hands are counted when operator new is.
+    inline void simpleHands()
+    {
+        typedef ofxLeapMotionSimpleHand::simpleFinger Finger;
+        typedef struct OldHand
+        {
+            vector< Finger, CountingAllocator<Finger> > fingers;
+            ofPoint handPos;
+            ofPoint handNormal;
+        } OldHand;
+
+        const int    frames   = 20000;
+        const string filename = "simpleHandsBenchmark.rec";
+        float        check    = 0;
+
+        size_t   allocations = CountingAllocator<Finger>::count() + CountingAllocator<OldHand>::count();
+        uint64_t start       = ofGetElapsedTimeMicros();
+        for (int f = 0; f < frames; f++)
+        {
+            vector< OldHand, CountingAllocator<OldHand> > hands;
+            for (int h = 0; h < 2; h++)
+            {
+                OldHand hand;
+                hand.handPos = ofPoint( f, h, 0 );
+                for (int k = 0; k < 5; k++)
+                {
+                    Finger finger;
+                    finger.pos = ofPoint( f, h, k );
+                    finger.vel = ofPoint( k, h, f );
+                    finger.id  = k;
+                    hand.fingers.push_back( finger );
+                }
+                hands.push_back( hand );
+            }
+            check += hands[1].fingers[4].pos.z;
+        }
+        uint64_t oldTime = ofGetElapsedTimeMicros() - start;
+        allocations = CountingAllocator<Finger>::count() + CountingAllocator<OldHand>::count() - allocations;
+
+        // no heap memory by construction, a copy is a memcpy
+        static_assert( std::is_trivially_copyable<ofxLeapMotionSimpleHands>::value,
+                       "simple hands have to stay plain values" );
+
+        // the fill of ofxLeapMotion::getSimpleHands() without the device
+        ofxLeapMotionSimpleHands hands;
+        size_t fillAllocations = heapAllocations();
+        start = ofGetElapsedTimeMicros();
+        for (int f = 0; f < frames; f++)
+        {
+            hands.clear();
+            for (int h = 0; h < 2; h++)
+            {
+                ofxLeapMotionSimpleHand &hand = hands.items[ hands.count++ ];
+                hand.handPos = ofPoint( f, h, 0 );
+                hand.fingers.clear();
+                for (int k = 0; k < 5; k++)
+                {
+                    Finger &finger = hand.fingers.items[ hand.fingers.count++ ];
+                    finger.pos = ofPoint( f, h, k );
+                    finger.vel = ofPoint( k, h, f );
+                    finger.id  = k;
+                }
+            }
+            check += hands[1].fingers[4].pos.z;
+        }
+        uint64_t fillTime = ofGetElapsedTimeMicros() - start;
+        fillAllocations = heapAllocations() - fillAllocations;
+
+        // the same hands recorded, an unloaded replay is a source without gestures
+        LeapReplay   noGestures;
+        LeapRecorder recorder;
+        if ( !recorder.open( filename ) )
+            return;
+
+        for (int f = 0; f < frames; f++)
+        {
+            for (int h = 0; h < 2; h++)
+            {
+                hands[h].handPos = ofPoint( f, h, 0 );
+                for (int k = 0; k < 5; k++)
+                {
+                    hands[h].fingers[k].pos = ofPoint( f, h, k );
+                    hands[h].fingers[k].vel = ofPoint( k, h, f );
+                }
+            }
+            recorder.record( noGestures, hands );
+        }
+        recorder.close();
+
+        LeapReplay replay;
+        if ( !replay.load( filename, false ) )
+            return;
+
+        size_t replayAllocations = heapAllocations();
+        start = ofGetElapsedTimeMicros();
+        while ( !replay.isFinished() )
+        {
+            replay.updateGestures();
+            replay.getSimpleHands( hands );
+            check += hands[1].fingers[4].pos.z;
+        }
+        uint64_t replayTime = ofGetElapsedTimeMicros() - start;
+        replayAllocations = heapAllocations() - replayAllocations;
+        ofFile::removeFile( filename );
+
+        ofLogNotice("Benchmarks") << "simple hands per frame: "
+                                  << "vectors " << oldTime * 1000 / frames << "ns, "
+                                  << (double)allocations / frames << " allocations, "
+                                  << "fixed fill " << fillTime * 1000 / frames << "ns, "
+                                  << "replayed getSimpleHands " << replayTime * 1000 / frames << "ns "
+                                  << "with the frame step, "
+                                  << sizeof(ofxLeapMotionSimpleHands) << " bytes, "
+                                  << ( isCountingHeap() ? ofToString( (double)fillAllocations / frames ) + " and " +
+                                                          ofToString( (double)replayAllocations / frames ) + " allocations"
+                                                        : "allocations not counted in this build" )
+                                  << ( check < 0 ? " " : "" );
+    }
+
+    // Gestures from a 120Hz producer thread with two or three per frame,
+    // read by a 60fps main thread that stalls for 100ms now and then.
+    // The old single gesture int against the event queue.
+    inline void gestureEvents()
+    {
+        const int frames = 180;
+
+        LockFreeQueue<ofxLeapMotionGestureEvent, 256> queue;
+        std::atomic<int>    latest( 0 );        // the old iGestures, a sequence number here
+        std::atomic<bool>   running( true );
+        std::atomic<size_t> produced( 0 ), dropped( 0 );
+
+        std::thread producer( [&]()
+        {
+            for (int frame = 0; running; frame++)
+            {
+                for (int k = 0; k < 2 + frame % 2; k++)
+                {
+                    ofxLeapMotionGestureEvent event;
+                    event.type        = 1 + ( frame + k ) % 10;
+                    event.frameId     = frame;
+                    event.timestamp   = 0;
+                    event.receiveTime = ofGetElapsedTimeMicros();
+
+                    latest = ++produced;
+                    if ( !queue.push( event ) )
+                        dropped++;
+                }
+                std::this_thread::sleep_for( std::chrono::microseconds( 8333 ) );
+            }
+        } );
+
+        size_t   seenInt = 0, seenQueue = 0;
+        int      lastInt = 0;
+        uint64_t drainTime = 0, latency = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            if ( latest != lastInt )
+            {
+                lastInt = latest;
+                seenInt++;
+            }
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            ofxLeapMotionGestureEvent event;
+            while ( queue.pop( event ) )
+            {
+                latency += start - event.receiveTime;
+                seenQueue++;
+            }
+            drainTime += ofGetElapsedTimeMicros() - start;
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( f % 30 == 29 ? 100 : 16 ) );
+        }
+
+        running = false;
+        producer.join();
+
+        ofLogNotice("Benchmarks") << "gestures, " << produced << " produced: "
+                                  << "single int saw " << seenInt << ", "
+                                  << "queue delivered " << seenQueue << " (" << dropped << " dropped, "
+                                  << "the rest still queued), "
+                                  << (double)drainTime / frames << "us/frame to drain, "
+                                  << ( seenQueue ? latency / seenQueue / 1000 : 0 ) << "ms average age";
+    }
+
+    // Scripted Leap input for the recording round trip, a gesture every fourth frame
+    class SyntheticLeapSource : public ofxLeapMotionSource
+    {
+    public:
+
+        void setFrame( int frame )
+        {
+            m_frame = frame;
+            m_events.clear();
+            if ( frame % 4 == 0 )
+            {
+                ofxLeapMotionGestureEvent event;
+                event.type        = 1 + frame % 10;
+                event.frameId     = frame;
+                event.timestamp   = frame * 8333;
+                event.receiveTime = 0;
+                event.position    = ofPoint( frame, -frame, 0.5f );
+                m_events.push_back( event );
+                iGestures = event.type;
+            }
+        }
+
+        virtual void updateGestures() {}
+        virtual void markFrameAsOld() {}
+
+        virtual const vector <ofxLeapMotionGestureEvent> & getGestureEvents() const
+            { return m_events; }
+
+        virtual void getSimpleHands( ofxLeapMotionSimpleHands & hands )
+        {
+            hands.clear();
+            for (int h = 0; h < 1 + m_frame % 2; h++)
+            {
+                ofxLeapMotionSimpleHand &hand = hands.items[ hands.count++ ];
+                hand.handPos    = ofPoint( m_frame, h, 200 );
+                hand.handNormal = ofPoint( 0, -1, h );
+                hand.fingers.clear();
+                for (int k = 0; k < 1 + ( m_frame + h ) % LEAP_MAX_FINGERS; k++)
+                {
+                    ofxLeapMotionSimpleHand::simpleFinger finger;
+                    finger.pos = ofPoint( k, m_frame * 0.25f, h );
+                    finger.vel = ofPoint( h, k, -m_frame );
+                    finger.id  = m_frame * 10 + k;
+                    hand.fingers.push_back( finger );
+                }
+            }
+        }
+
+    private:
+
+        int                                 m_frame;
+        vector<ofxLeapMotionGestureEvent>   m_events;
+    };
+
+    // A minute of synthetic 60fps Leap input recorded, replayed as fast as
+    // possible and compared frame by frame with what was recorded
+    inline void leapRecordReplay()
+    {
+        const int    frames   = 3600;
+        const string filename = "leapBenchmark.rec";
+
+        SyntheticLeapSource       source;
+        ofxLeapMotionSimpleHands  hands, replayed;
+        LeapRecorder              recorder;
+        if ( !recorder.open( filename ) )
+            return;
+
+        uint64_t start = ofGetElapsedTimeMicros();
+        for (int f = 0; f < frames; f++)
+        {
+            source.setFrame( f );
+            source.getSimpleHands( hands );
+            recorder.record( source, hands );
+        }
+        recorder.close();
+        uint64_t recordTime = ofGetElapsedTimeMicros() - start;
+
+        LeapReplay replay;
+        if ( !replay.load( filename, false ) )
+            return;
+
+        size_t mismatches = 0, events = 0;
+        start = ofGetElapsedTimeMicros();
+        for (int f = 0; !replay.isFinished(); f++)
+        {
+            replay.updateGestures();
+            replay.markFrameAsOld();
+            replay.getSimpleHands( replayed );
+
+            source.setFrame( f );
+            source.getSimpleHands( hands );
+
+            const vector<ofxLeapMotionGestureEvent> &expected = source.getGestureEvents();
+            const vector<ofxLeapMotionGestureEvent> &got      = replay.getGestureEvents();
+            events += got.size();
+
+            bool same = got.size() == expected.size() && replayed.size() == hands.size() &&
+                        replay.iGestures == source.iGestures;
+            for (size_t i = 0; same && i < got.size(); i++)
+                same = got[i].type == expected[i].type && got[i].frameId == expected[i].frameId &&
+                       got[i].position == expected[i].position;
+            for (int h = 0; same && h < hands.size(); h++)
+            {
+                same = replayed[h].handPos == hands[h].handPos && replayed[h].handNormal == hands[h].handNormal &&
+                       replayed[h].fingers.size() == hands[h].fingers.size();
+                for (int k = 0; same && k < hands[h].fingers.size(); k++)
+                    same = replayed[h].fingers[k].pos == hands[h].fingers[k].pos &&
+                           replayed[h].fingers[k].vel == hands[h].fingers[k].vel &&
+                           replayed[h].fingers[k].id  == hands[h].fingers[k].id;
+            }
+            if ( !same )
+                mismatches++;
+        }
+        uint64_t replayTime = ofGetElapsedTimeMicros() - start;
+
+        ofFile file( ofToDataPath( filename ) );
+        ofLogNotice("Benchmarks") << "leap recording of " << frames << " frames: "
+                                  << file.getSize() / frames << " bytes/frame, "
+                                  << "record " << recordTime * 1000 / frames << "ns/frame, "
+                                  << "replay " << replayTime * 1000 / frames << "ns/frame, "
+                                  << replay.getNumFrames() << " frames and " << events << " gestures replayed, "
+                                  << mismatches << " mismatched";
+        ofFile::removeFile( filename );
+    }
+
+    // Map frames of a panning view, prepared in place against one frame ahead
+    // on the worker. The main thread's own part of a frame - draw list, GL
+    // submit, waiting on the driver - is stood in for by a 3ms sleep.
+    inline void framePipeline( double latRange, double lonRange )
+    {
+        const size_t count  = 1000000;
+        const int    frames = 300;
+
+        CityPointStore points;
+        vector<float> latitude, longitude;
+        randomCity( latitude, longitude, count, 37.77, -122.42, 0.1 );
+        points.reserve( count );
+        int name = points.intern( "Market Street", 13 );
+        for (size_t i = 0; i < count; i++)
+            points.addPoint( latitude[i], longitude[i], name, name );
+        Utils::computeDisplayColors( points );
+
+        GeoGrid grid;
+        grid.build( points.latitude, points.longitude );
+
+        uint64_t frameTime[2], stalls[2], stallTime[2];
+        float    prepareTime[2];
+        size_t   visible = 0, late = 0;
+        for (int threaded = 0; threaded < 2; threaded++)
+        {
+            FramePipeline pipeline;
+            if ( threaded )
+                pipeline.start();
+
+            double lat = 37.77, lon = -122.42, lastLat = 0;
+            uint64_t start = ofGetElapsedTimeMicros();
+            for (int f = 0; f < frames; f++)
+            {
+                lat += 0.0001;
+                lon += 0.00005;
+
+                FrameRequest request;
+                request.grid        = &grid;
+                request.points      = &points;
+                calibrateProjector( request.projector, lat, lon );
+                request.latitude    = lat;
+                request.longitude   = lon;
+                request.latRange    = latRange;
+                request.lonRange    = lonRange;
+                request.generation  = 0;
+                request.cacheColors = true;
+
+                PreparedFrame &frame = pipeline.take();
+                pipeline.submit( request );
+
+                // what is drawn is the view of the frame before
+                if ( f > 0 && frame.request.latitude != lastLat )
+                    late++;
+                lastLat = lat;
+                visible = frame.visibleSet.size();
+
+                std::this_thread::sleep_for( std::chrono::milliseconds( 3 ) );
+            }
+            pipeline.take();
+            frameTime[threaded] = ( ofGetElapsedTimeMicros() - start ) / frames;
+
+            stalls[threaded]      = pipeline.getNumStalls();
+            stallTime[threaded]   = pipeline.getStallMicros() / frames;
+            prepareTime[threaded] = pipeline.getAveragePrepareTime();
+            pipeline.stop();
+        }
+
+        ofLogNotice("Benchmarks") << "frame pipeline, " << visible << " visible: "
+                                  << "in place " << frameTime[0] << "us/frame (prepare " << prepareTime[0] << "us), "
+                                  << "worker " << frameTime[1] << "us/frame (prepare " << prepareTime[1] << "us, "
+                                  << stalls[1] << " stalls, " << stallTime[1] << "us/frame waiting), "
+                                  << late << " frames more than one behind";
+    }
+
+    // Frame preparation - viewport scan, map pixel kernel and expansion -
+    // rebuilt every frame on a task pool of 1 to all cores, with the
+    // chunk timings of the largest pool
+    //--------------------------------------------------------------
+    inline void taskPoolScaling( double latRange, double lonRange )
+    {
+        const size_t count  = 1000000;
+        const int    frames = 20;
+
+        // dense enough that about a third of the points are visible
+        CityPointStore points;
+        vector<float> latitude, longitude;
+        randomCity( latitude, longitude, count, 37.77, -122.42, 0.02 );
+        points.reserve( count );
+        int name = points.intern( "Market Street", 13 );
+        for (size_t i = 0; i < count; i++)
+            points.addPoint( latitude[i], longitude[i], name, name );
+        Utils::computeDisplayColors( points );
+
+        GeoGrid grid;
+        grid.build( points.latitude, points.longitude );
+
+        PreparedFrame frame;
+        frame.generation = -1;
+        frame.request.grid        = &grid;
+        frame.request.points      = &points;
+        calibrateProjector( frame.request.projector, 37.77, -122.42 );
+        frame.request.latitude    = 37.77;
+        frame.request.longitude   = -122.42;
+        frame.request.latRange    = latRange;
+        frame.request.lonRange    = lonRange;
+        frame.request.cacheColors = true;
+
+        int cores = std::max( (int)std::thread::hardware_concurrency(), 1 );
+        uint64_t single = 0;
+        for (int threads = 1; threads <= cores; threads++)
+        {
+            TaskPool pool;
+            pool.start( threads - 1 );
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            for (int f = 0; f < frames; f++)
+            {
+                frame.request.generation = f;   // full rebuild
+                FramePipeline::prepare( frame, &pool );
+            }
+            uint64_t time = ( ofGetElapsedTimeMicros() - start ) / frames;
+            if ( threads == 1 )
+                single = time;
+
+            ofLogNotice("Benchmarks") << "task pool, " << frame.visibleSet.size() << " visible on "
+                                      << threads << " threads: " << time << "us/frame, "
+                                      << (float)single / std::max( time, (uint64_t)1 ) << "x";
+            if ( threads == cores )
+                pool.logStats( "Benchmarks" );
+            pool.stop();
+        }
+    }
+
+} // End of Benchmarks
@@ -0,0 +1,275 @@
+//
+//  CityDataFile.h
+//
+//  3/26/14.
+//
+//
+//  Binary city data file - the cityData and elevationData text files
+//  converted once (see tools/cityDataConverter.cpp) and memory mapped at startup.
+//  The points are stored as the columns of CityPointStore, so loading is one
+//  block copy per column out of the mapping. Every section is checked against
+//  the file size and every id against its range before anything is read.
+//
+//  Layout, native little endian, sections and columns 8 byte aligned:
+//      CityDataHeader
+//      columns of pointCount values each, in CityDataColumn order
+//      uint32_t            nameStart[nameCount + 1], then the name characters
+//      CityDataGrid        grid
+//      int32_t             cellStart[rows * cols + 1]
+//      int32_t             ids[pointCount]
+
+#pragma once
+
+#include <fstream>
+
+#include "ofMain.h"
+#include "MappedFile.h"
+#include "GeoGrid.h"
+#include "CityPointStore.h"
+
+#define CITYDATA_MAGIC   0x44435743     // "CWCD"
+#define CITYDATA_VERSION 2
+
+typedef struct CityDataHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pointCount;
+    uint32_t nameCount;
+    uint64_t columnOffset;
+    uint64_t nameOffset;
+    uint64_t gridOffset;
+    uint64_t fileSize;
+} CityDataHeader;
+
+// Point columns, 4 bytes per value each
+enum CityDataColumn
+{
+    CITYDATA_LATITUDE,      // float
+    CITYDATA_LONGITUDE,     // float
+    CITYDATA_MERCATOR_Y,    // float
+    CITYDATA_ELEVATION,     // float
+    CITYDATA_COLOR,         // uint8_t[4]
+    CITYDATA_STREET_ID,     // int32_t
+    CITYDATA_CITY_ID,       // int32_t
+    CITYDATA_NUM_COLUMNS
+};
+
+typedef struct CityDataGrid
+{
+    double   minLat;
+    double   minLon;
+    double   cellSize;
+    int32_t  rows;
+    int32_t  cols;
+} CityDataGrid;
+
+
+namespace CityDataFile {
+
+    //--------------------------------------------------------------
+    inline uint64_t align8( uint64_t offset )
+    {
+        return ( offset + 7 ) & ~(uint64_t)7;
+    }
+
+    // Offset of a column from the first one
+    //--------------------------------------------------------------
+    inline uint64_t columnStart( uint32_t pointCount, int column )
+    {
+        return column * align8( (uint64_t)pointCount * 4 );
+    }
+
+    //--------------------------------------------------------------
+    inline bool save( const CityPointStore &points, const GeoGrid &grid, string filename )
+    {
+        const vector<string> &names = points.getNames();
+
+        uint64_t nameBytes = 0;
+        for (size_t i = 0; i < names.size(); i++)
+            nameBytes += names[i].size();
+
+        size_t cellCount = (size_t)grid.getRows() * grid.getCols();
+
+        CityDataHeader header;
+        header.magic        = CITYDATA_MAGIC;
+        header.version      = CITYDATA_VERSION;
+        header.pointCount   = points.size();
+        header.nameCount    = names.size();
+        header.columnOffset = align8( sizeof(CityDataHeader) );
+        header.nameOffset   = header.columnOffset + columnStart( points.size(), CITYDATA_NUM_COLUMNS );
+        header.gridOffset   = align8( header.nameOffset + ( names.size() + 1 ) * sizeof(uint32_t) + nameBytes );
+        header.fileSize     = header.gridOffset + sizeof(CityDataGrid)
+                            + ( cellCount + 1 + points.size() ) * sizeof(int32_t);
+
+        vector<char> out( header.fileSize, 0 );
+        memcpy( &out[0], &header, sizeof(header) );
+
+        char  *columns = &out[ header.columnOffset ];
+        size_t count   = points.size();
+        if ( count > 0 )
+        {
+            memcpy( columns + columnStart( count, CITYDATA_LATITUDE ),   &points.latitude[0],  count * 4 );
+            memcpy( columns + columnStart( count, CITYDATA_LONGITUDE ),  &points.longitude[0], count * 4 );
+            memcpy( columns + columnStart( count, CITYDATA_MERCATOR_Y ), &points.mercatorY[0], count * 4 );
+            memcpy( columns + columnStart( count, CITYDATA_ELEVATION ),  &points.elevation[0], count * 4 );
+        }
+
+        uint8_t *color    = (uint8_t*)( columns + columnStart( count, CITYDATA_COLOR ) );
+        int32_t *streetId = (int32_t*)( columns + columnStart( count, CITYDATA_STREET_ID ) );
+        int32_t *cityId   = (int32_t*)( columns + columnStart( count, CITYDATA_CITY_ID ) );
+        for (size_t i = 0; i < count; i++)
+        {
+            color[i * 4 + 0] = points.color[i].r;
+            color[i * 4 + 1] = points.color[i].g;
+            color[i * 4 + 2] = points.color[i].b;
+            color[i * 4 + 3] = points.color[i].a;
+            streetId[i]      = points.streetId[i];
+            cityId[i]        = points.cityId[i];
+        }
+
+        uint32_t *nameStart = (uint32_t*)&out[ header.nameOffset ];
+        char     *chars     = (char*)( nameStart + names.size() + 1 );
+        uint32_t  position  = 0;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            nameStart[i] = position;
+            memcpy( chars + position, names[i].data(), names[i].size() );
+            position += names[i].size();
+        }
+        nameStart[ names.size() ] = position;
+
+        CityDataGrid gridHeader;
+        gridHeader.minLat   = grid.getMinLatitude();
+        gridHeader.minLon   = grid.getMinLongitude();
+        gridHeader.cellSize = grid.getCellSize();
+        gridHeader.rows     = grid.getRows();
+        gridHeader.cols     = grid.getCols();
+        memcpy( &out[ header.gridOffset ], &gridHeader, sizeof(gridHeader) );
+
+        char *cells = &out[ header.gridOffset + sizeof(CityDataGrid) ];
+        if ( !grid.getCellStarts().empty() )
+            memcpy( cells, &grid.getCellStarts()[0], ( cellCount + 1 ) * sizeof(int32_t) );
+        if ( !grid.getIds().empty() )
+            memcpy( cells + ( cellCount + 1 ) * sizeof(int32_t), &grid.getIds()[0], points.size() * sizeof(int32_t) );
+
+        ofstream file( ofToDataPath( filename ).c_str(), ios::binary );
+        file.write( &out[0], out.size() );
+
+        return file.good();
+    }
+
+    // Fills points and grid straight from the mapping, false if the file
+    // is missing, from another version, truncated or inconsistent
+    //--------------------------------------------------------------
+    inline bool load( CityPointStore &points, GeoGrid &grid, string filename )
+    {
+        MappedFile file;
+        if ( !file.open( filename ) || file.size() < sizeof(CityDataHeader) )
+            return false;
+
+        const char *data = file.data();
+        uint64_t    size = file.size();
+        CityDataHeader header;
+        memcpy( &header, data, sizeof(header) );
+
+        if ( header.magic != CITYDATA_MAGIC || header.version != CITYDATA_VERSION || header.fileSize != size )
+        {
+            ofLogError("CityDataFile") << filename << " is not a version " << CITYDATA_VERSION << " city data file";
+            return false;
+        }
+
+        // sections in order, aligned and inside the file. The offsets are
+        // checked against the size first, after that the 32 bit counts
+        // keep every sum below far from overflowing
+        if ( header.columnOffset > size || header.nameOffset > size || header.gridOffset > size )
+        {
+            ofLogError("CityDataFile") << filename << " is truncated or corrupt";
+            return false;
+        }
+
+        uint32_t count    = header.pointCount;
+        uint64_t charsAt  = header.nameOffset + ( (uint64_t)header.nameCount + 1 ) * sizeof(uint32_t);
+        uint64_t cellsAt  = header.gridOffset + sizeof(CityDataGrid);
+        bool     sections = header.columnOffset % 8 == 0 && header.nameOffset % 8 == 0 && header.gridOffset % 8 == 0 &&
+                            header.columnOffset >= sizeof(CityDataHeader) &&
+                            header.columnOffset + columnStart( count, CITYDATA_NUM_COLUMNS ) <= header.nameOffset &&
+                            charsAt <= header.gridOffset && sizeof(CityDataGrid) <= size - header.gridOffset;
+
+        CityDataGrid gridHeader;
+        if ( sections )
+        {
+            memcpy( &gridHeader, data + header.gridOffset, sizeof(gridHeader) );
+            sections = gridHeader.rows > 0 && gridHeader.cols > 0 && gridHeader.cellSize > 0 &&
+                       cellsAt + ( (uint64_t)gridHeader.rows * gridHeader.cols + 1 + count ) * sizeof(int32_t) == size;
+        }
+        if ( !sections )
+        {
+            ofLogError("CityDataFile") << filename << " is truncated or corrupt";
+            return false;
+        }
+
+        const char     *columns   = data + header.columnOffset;
+        const uint32_t *nameStart = (const uint32_t*)( data + header.nameOffset );
+        const char     *chars     = data + charsAt;
+        const uint8_t  *color     = (const uint8_t*)( columns + columnStart( count, CITYDATA_COLOR ) );
+        const int32_t  *streetId  = (const int32_t*)( columns + columnStart( count, CITYDATA_STREET_ID ) );
+        const int32_t  *cityId    = (const int32_t*)( columns + columnStart( count, CITYDATA_CITY_ID ) );
+        size_t          cellCount = (size_t)gridHeader.rows * gridHeader.cols;
+        const int32_t  *cellStart = (const int32_t*)( data + cellsAt );
+        const int32_t  *ids       = cellStart + cellCount + 1;
+
+        // every offset and id in range before it is used
+        bool valid = nameStart[0] == 0 && nameStart[ header.nameCount ] <= header.gridOffset - charsAt;
+        for (uint32_t i = 0; valid && i < header.nameCount; i++)
+            valid = nameStart[i] <= nameStart[i + 1];
+        for (uint32_t i = 0; valid && i < count; i++)
+            valid = (uint32_t)streetId[i] < header.nameCount && (uint32_t)cityId[i] < header.nameCount;
+        valid = valid && cellStart[0] == 0 && cellStart[cellCount] == (int32_t)count;
+        for (size_t i = 0; valid && i < cellCount; i++)
+            valid = cellStart[i] <= cellStart[i + 1];
+        for (uint32_t i = 0; valid && i < count; i++)
+            valid = (uint32_t)ids[i] < count;
+
+        if ( !valid )
+        {
+            ofLogError("CityDataFile") << filename << " has names, ids or grid cells out of range";
+            return false;
+        }
+
+        points.clear();
+
+        // names are interned in file order so their ids match the columns
+        for (uint32_t i = 0; i < header.nameCount; i++)
+            points.intern( chars + nameStart[i], nameStart[i + 1] - nameStart[i] );
+
+        const float *latitude = (const float*)( columns + columnStart( count, CITYDATA_LATITUDE ) );
+        points.latitude.assign( latitude, latitude + count );
+
+        const float *longitude = (const float*)( columns + columnStart( count, CITYDATA_LONGITUDE ) );
+        points.longitude.assign( longitude, longitude + count );
+
+        const float *mercatorY = (const float*)( columns + columnStart( count, CITYDATA_MERCATOR_Y ) );
+        points.mercatorY.assign( mercatorY, mercatorY + count );
+
+        const float *elevation = (const float*)( columns + columnStart( count, CITYDATA_ELEVATION ) );
+        points.elevation.assign( elevation, elevation + count );
+
+        points.streetId.assign( streetId, streetId + count );
+        points.cityId.assign( cityId, cityId + count );
+
+        points.color.resize( count );
+        for (uint32_t i = 0; i < count; i++)
+            points.color[i] = ofColor( color[i * 4 + 0], color[i * 4 + 1], color[i * 4 + 2], color[i * 4 + 3] );
+
+        points.rebuildIndex();
+
+        grid.load( gridHeader.minLat, gridHeader.minLon, gridHeader.cellSize,
+                   gridHeader.rows, gridHeader.cols,
+                   cellStart, ids,
+                   points.latitude, points.longitude );
+
+        return true;
+    }
+
+} // End of CityDataFile
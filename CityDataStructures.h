@@ -14,10 +14,3 @@ typedef struct City
     float  longitude;
 } City;
 
-// GeoData
-typedef struct GeoData
-{
-    string street;
-    string city;
-} GeoData;
-
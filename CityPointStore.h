@@ -0,0 +1,151 @@
+//
+//  CityPointStore.h
+//
+//  3/26/14.
+//
+//
+//  Columnar store of the city data points.
+//  One contiguous array per attribute, indexed by point id, so the culling
+//  and render loops stream through memory instead of chasing map nodes.
+//  Street and city names are interned once and referenced by id.
+
+#pragma once
+
+#include "ofMain.h"
+#include "GeoKey.h"
+#include "MercatorProjector.h"
+
+class CityPointStore
+{
+public:
+
+    vector<float>   latitude;
+    vector<float>   longitude;
+    vector<float>   mercatorY;      // projection input, see MercatorProjector
+    vector<float>   elevation;
+    vector<ofColor> color;
+    vector<int>     streetId;
+    vector<int>     cityId;
+
+    // final colors for the map, filled by Utils::computeDisplayColors
+    vector<ofColor> displayColor;
+    vector<ofColor> cacheColor;
+
+    //--------------------------------------------------------------
+    void clear()
+    {
+        latitude.clear();
+        longitude.clear();
+        mercatorY.clear();
+        elevation.clear();
+        color.clear();
+        streetId.clear();
+        cityId.clear();
+        displayColor.clear();
+        cacheColor.clear();
+
+        m_names.clear();
+        m_nameIds.clear();
+        m_index.clear();
+    }
+
+    //--------------------------------------------------------------
+    void reserve( size_t count )
+    {
+        latitude.reserve( count );
+        longitude.reserve( count );
+        mercatorY.reserve( count );
+        elevation.reserve( count );
+        color.reserve( count );
+        streetId.reserve( count );
+        cityId.reserve( count );
+
+        m_index.reserve( count );
+    }
+
+    // Appends a point with default color and zero elevation, returns its id
+    //--------------------------------------------------------------
+    int addPoint( float lat, float lon, const string &street, const string &city )
+    {
+        return addPoint( lat, lon, intern( street ), intern( city ) );
+    }
+
+    // Same with names that are already interned
+    //--------------------------------------------------------------
+    int addPoint( float lat, float lon, int street, int city )
+    {
+        int id = latitude.size();
+
+        latitude.push_back( lat );
+        longitude.push_back( lon );
+        mercatorY.push_back( MercatorProjector::toMercatorY( lat ) );
+        elevation.push_back( 0 );
+        color.push_back( ofColor() );
+        streetId.push_back( street );
+        cityId.push_back( city );
+
+        // a repeated location resolves to the latest point, like the old maps
+        m_index[ makeGeoKey(lat, lon) ] = id;
+
+        return id;
+    }
+
+    // Location index over the columns, after they were filled in bulk
+    //--------------------------------------------------------------
+    void rebuildIndex()
+    {
+        m_index.clear();
+        m_index.reserve( latitude.size() );
+        for (size_t id = 0; id < latitude.size(); id++)
+            m_index[ makeGeoKey(latitude[id], longitude[id]) ] = id;
+    }
+
+    // Point id at exactly this location, -1 if there is none
+    //--------------------------------------------------------------
+    int findPoint( float lat, float lon ) const
+    {
+        const int *id = m_index.find( makeGeoKey(lat, lon) );
+        return id ? *id : -1;
+    }
+
+    //--------------------------------------------------------------
+    int intern( const string &name )
+    {
+        map<string,int>::iterator it = m_nameIds.find( name );
+        if ( it != m_nameIds.end() )
+            return it->second;
+
+        int id = m_names.size();
+        m_names.push_back( name );
+        m_nameIds[name] = id;
+
+        return id;
+    }
+
+    // Same for a name inside a larger buffer - no allocation once the name is known
+    //--------------------------------------------------------------
+    int intern( const char *name, size_t length )
+    {
+        m_scratch.assign( name, length );
+        return intern( m_scratch );
+    }
+
+    //--------------------------------------------------------------
+    const string& getName( int nameId ) const
+        { return m_names[nameId]; }
+
+    //--------------------------------------------------------------
+    const vector<string>& getNames() const
+        { return m_names; }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return latitude.size(); }
+
+private:
+
+    vector<string>      m_names;    // interned street and city names
+    map<string,int>     m_nameIds;
+    string              m_scratch;
+    GeoKeyMap<int>      m_index;    // location -> point id
+};
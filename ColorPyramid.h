@@ -0,0 +1,203 @@
+//
+//  ColorPyramid.h
+//
+//  3/26/14.
+//
+//
+//  Level of detail pyramid over the city points for zoomed out views.
+//  Every level aggregates the points into square lat/lon cells (mean
+//  position, colors and elevation, point count), the cell size doubles
+//  from one level to the next. A level is a CityPointStore of its cells
+//  with its own GeoGrid, so culling and drawing work on it unchanged.
+//  The street and city names of a cell are the ones of its first point.
+
+#pragma once
+
+#include "ofMain.h"
+#include "GeoGrid.h"
+#include "GeoKey.h"
+#include "CityPointStore.h"
+
+class ColorPyramid
+{
+public:
+
+    // Run after Utils::computeDisplayColors, cellSize is the cell size of level 0 in degrees
+    //--------------------------------------------------------------
+    void build( const CityPointStore &points, double cellSize = 0.0005, int numLevels = 6 )
+    {
+        m_levels.clear();
+        m_levels.resize( numLevels );
+
+        if ( points.size() == 0 || numLevels == 0 )
+            return;
+
+        float minLat = *std::min_element( points.latitude.begin(),  points.latitude.end() );
+        float minLon = *std::min_element( points.longitude.begin(), points.longitude.end() );
+
+        // level 0 from the points
+        Sums sums;
+        sums.reserve( points.size() );
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const ofColor &clr     = points.color[i];
+            const ofColor &display = points.displayColor[i];
+            const ofColor &cache   = points.cacheColor[i];
+
+            double point[SUMS] = { points.latitude[i], points.longitude[i], points.elevation[i],
+                                   (double)clr.r,     (double)clr.g,     (double)clr.b,
+                                   (double)display.r, (double)display.g, (double)display.b,
+                                   (double)cache.r,   (double)cache.g,   (double)cache.b };
+
+            GeoKey row = GeoKey( ( points.latitude[i]  - minLat ) / cellSize );
+            GeoKey col = GeoKey( ( points.longitude[i] - minLon ) / cellSize );
+            sums.add( ( row << 32 ) | col, point, 1, i );
+        }
+
+        // every coarser level from the one before, four cells merge into one
+        for (int l = 0; l < numLevels; l++)
+        {
+            m_levels[l].cellSize = cellSize;
+            makeLevel( points, sums, m_levels[l] );
+
+            if ( l + 1 == numLevels )
+                break;
+
+            Sums parents;
+            parents.reserve( sums.size() );
+
+            for (size_t c = 0; c < sums.size(); c++)
+            {
+                GeoKey row = sums.keys[c] >> 33;
+                GeoKey col = ( sums.keys[c] & 0xffffffffULL ) >> 1;
+                parents.add( ( row << 32 ) | col, &sums.values[ c * SUMS ], sums.count[c], sums.first[c] );
+            }
+
+            sums.swap( parents );
+            cellSize *= 2;
+        }
+    }
+
+    //--------------------------------------------------------------
+    int getNumLevels() const
+        { return m_levels.size(); }
+
+    //--------------------------------------------------------------
+    const CityPointStore& getCells( int level ) const
+        { return m_levels[level].cells; }
+
+    //--------------------------------------------------------------
+    const GeoGrid& getGrid( int level ) const
+        { return m_levels[level].grid; }
+
+    // Number of points aggregated per cell
+    //--------------------------------------------------------------
+    const vector<int>& getCounts( int level ) const
+        { return m_levels[level].count; }
+
+    //--------------------------------------------------------------
+    double getCellSize( int level ) const
+        { return m_levels[level].cellSize; }
+
+private:
+
+    // position, elevation and the three color columns
+    static const int SUMS = 12;
+
+    typedef struct Level
+    {
+        CityPointStore  cells;
+        GeoGrid         grid;
+        vector<int>     count;
+        double          cellSize;
+    } Level;
+
+    // Running sums per cell, keyed by row << 32 | col
+    typedef struct Sums
+    {
+        GeoKeyMap<int>  index;
+        vector<GeoKey>  keys;
+        vector<double>  values;     // SUMS per cell
+        vector<int>     count;
+        vector<int>     first;      // first point of the cell
+
+        void reserve( size_t cells )
+        {
+            index.reserve( cells );
+            keys.reserve( cells );
+            values.reserve( cells * SUMS );
+            count.reserve( cells );
+            first.reserve( cells );
+        }
+
+        void add( GeoKey key, const double *value, int n, int point )
+        {
+            int &slot = index[key];
+            if ( slot == 0 )
+            {
+                // slots are stored one based, 0 is a new cell
+                keys.push_back( key );
+                values.resize( values.size() + SUMS, 0 );
+                count.push_back( 0 );
+                first.push_back( point );
+                slot = keys.size();
+            }
+
+            double *sum = &values[ ( slot - 1 ) * SUMS ];
+            for (int k = 0; k < SUMS; k++)
+                sum[k] += value[k];
+            count[ slot - 1 ] += n;
+        }
+
+        size_t size() const
+            { return keys.size(); }
+
+        void swap( Sums &other )
+        {
+            std::swap( index, other.index );
+            keys.swap( other.keys );
+            values.swap( other.values );
+            count.swap( other.count );
+            first.swap( other.first );
+        }
+    } Sums;
+
+    // One cell point per cell at the mean of its points
+    //--------------------------------------------------------------
+    void makeLevel( const CityPointStore &points, const Sums &sums, Level &level )
+    {
+        CityPointStore &cells = level.cells;
+        cells.reserve( sums.size() );
+        cells.displayColor.resize( sums.size() );
+        cells.cacheColor.resize( sums.size() );
+        level.count = sums.count;
+
+        // name ids of the points to name ids of the cells, interned on first use
+        vector<int> nameOf( points.getNames().size(), -1 );
+
+        for (size_t c = 0; c < sums.size(); c++)
+        {
+            const double *sum = &sums.values[ c * SUMS ];
+            double k = 1.0 / sums.count[c];
+
+            int street = points.streetId[ sums.first[c] ];
+            int city   = points.cityId  [ sums.first[c] ];
+            if ( nameOf[street] < 0 )
+                nameOf[street] = cells.intern( points.getName( street ) );
+            if ( nameOf[city] < 0 )
+                nameOf[city] = cells.intern( points.getName( city ) );
+
+            int id = cells.addPoint( sum[0] * k, sum[1] * k, nameOf[street], nameOf[city] );
+
+            cells.elevation[id]    = sum[2] * k;
+            cells.color[id]        = ofColor( sum[3] * k, sum[4]  * k, sum[5]  * k );
+            cells.displayColor[id] = ofColor( sum[6] * k, sum[7]  * k, sum[8]  * k );
+            cells.cacheColor[id]   = ofColor( sum[9] * k, sum[10] * k, sum[11] * k );
+        }
+
+        level.grid.build( cells.latitude, cells.longitude );
+    }
+
+    vector<Level> m_levels;     // finest first
+};
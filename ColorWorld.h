@@ -12,11 +12,32 @@
 
 #include "Map.h"
 #include "LeapWrapper.h"
+#include "LeapRecording.h"
 #include "CityDataStructures.h"
+#include "GeoGrid.h"
+#include "GeoKey.h"
+#include "CityPointStore.h"
+#include "CsvIngest.h"
+#include "MapPixelBatch.h"
+#include "DrawList.h"
+#include "MapPixelCurves.h"
+#include "MapPixelKernel.h"
+#include "MercatorProjector.h"
+#include "KdTree.h"
+#include "ScreenGrid.h"
+#include "VisibleSet.h"
+#include "ColorPyramid.h"
+#include "FramePipeline.h"
+#include "TaskPool.h"
+#include "StreetViewFetcher.h"
+#include "StreetViewImageStore.h"
+#include "StreetViewAtlas.h"
 
 #include "OpenStreetMapProvider.h"
 #include "GeoUtils.h"
 #include "Utils.h"
+#include "CityDataFile.h"
+#include "Benchmarks.h"
 
 #include "ofMain.h"
 #include "ofxTween.h"
@@ -26,10 +47,17 @@
 class ColorWorld : public ofBaseApp
 {
 	public:
+        ColorWorld()
+            { m_headless = false; }
+    
 		void setup();
 		void update();
 		void draw();
         void exit();
+    
+        // the app without a window - see tools/colorWorldHeadless.cpp
+        void runHeadless( int frames );
+        void runBenchmarks();
 		
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -47,6 +75,13 @@ class ColorWorld : public ofBaseApp
         double getMoveMouseX( );
         double getMoveMouseY( );
     
+        // frame contents into m_drawList, draw() submits them
+        void compute();
+    
+        // points and grid of the current zoom
+        const CityPointStore& getViewPoints() const;
+        const GeoGrid&        getViewGrid() const;
+    
         // private method : gesture debug purpose
         void gestureDebug();
     
@@ -58,15 +93,20 @@ class ColorWorld : public ofBaseApp
     
         // Leap Object
         ofxLeapMotion   m_leapObj;
+        LeapReplay      m_leapReplay;
+        LeapRecorder    m_leapRecorder;
+        ofxLeapMotionSource *m_leapInput;   // m_leapObj or m_leapReplay
         ofPoint         m_leapPalmPos;
-        vector <ofxLeapMotionSimpleHand> m_leapHands;
+        ofxLeapMotionSimpleHands m_leapHands;
 
         // Modest Map object
-        Map             m_map;
+        Map                 m_map;
+        MercatorProjector   m_projector;
     
         // Google MapView ofImages
         ofImage         m_gMapView;
-        ofImage         m_gStreetView;
+        StreetViewCache     m_streetViewCache;
+        StreetViewFetcher   m_streetViewFetcher;
     
         // Location informations
         double          m_longitude;
@@ -78,14 +118,32 @@ class ColorWorld : public ofBaseApp
         vector<City>    m_cityLocations;
     
         // Map Data
-        vector<ofPoint>     m_coordinates;
-        map<string,ofColor> m_colorData;
-        map<string,GeoData> m_streetData;
-        map<string,float>   m_elevationData;
-        map<string,ofImage> m_imageData;
-    
-        vector<ofPoint> m_onMapPos;
-        vector<ofPoint> m_onMapClr;
+        CityPointStore      m_cityPoints;
+        StreetViewAtlas     m_streetViewAtlas;
+        StreetViewImageStore m_streetViewImages;
+        int                 m_streetViewId;     // point of the offline street view shown
+        GeoGrid             m_pointGrid;
+        ColorPyramid        m_colorPyramid;
+        int                 m_zoom;
+        int                 m_viewLevel;    // pyramid level drawn, -1 for the raw points
+        KdTree              m_pointTree;
+    
+        TaskPool            m_taskPool;
+        FramePipeline       m_framePipeline;
+        PreparedFrame      *m_frame;        // map of the frame drawn, prepared from the last update()
+        int                 m_viewGeneration;   // changes with the zoom, the visible sets start over
+        DrawList            m_drawList;
+    
+        // Frame stage timings, microseconds of the last frame
+        enum FrameStage { STAGE_UPDATE, STAGE_PREPARE, STAGE_MAP, STAGE_COLLECT, STAGE_OVERLAY, STAGE_SUBMIT, NUM_FRAME_STAGES };
+        uint64_t            m_stageTime[NUM_FRAME_STAGES];
+        bool                m_headless;
+    
+        // Finger locations and their nearest points
+        vector<float>       m_fingerLat;
+        vector<float>       m_fingerLon;
+        vector<int>         m_fingerPointIds;
+        vector<int>         m_prefetchIds;
     
         // Music Object
         ofSoundPlayer   m_bgm;
@@ -0,0 +1,168 @@
+//
+//  CsvIngest.h
+//
+//  3/26/14.
+//
+//
+//  Multi-threaded parser for the "lat,lon,..." text data files.
+//  The buffer is split at newline boundaries across cores, numbers are
+//  parsed in place with std::from_chars and text fields are kept as
+//  offsets into the buffer, so there is no heap allocation per line.
+//  Every thread writes straight into its slice of one row array.
+
+#pragma once
+
+#include <thread>
+#include <charconv>
+
+#include "ofMain.h"
+
+#define CSV_MAX_FIELDS 4
+
+// One parsed line, field offsets are relative to the start of the buffer
+typedef struct CsvRow
+{
+    float    lat;
+    float    lon;
+    float    value;                         // third field as a number, 0 when it is text
+    uint32_t fieldStart[CSV_MAX_FIELDS];
+    uint32_t fieldLength[CSV_MAX_FIELDS];
+    int      fieldCount;                    // 0 for blank lines
+} CsvRow;
+
+
+namespace CsvIngest {
+
+    //--------------------------------------------------------------
+    inline float toFloat( const char *begin, const char *end )
+    {
+        float value = 0;
+        std::from_chars( begin, end, value );
+        return value;
+    }
+
+    //--------------------------------------------------------------
+    inline void parseLine( const char *text, const char *begin, const char *end, CsvRow &row )
+    {
+        row.fieldCount = 0;
+
+        while ( end > begin && ( end[-1] == '\r' || end[-1] == ' ' ) )
+            end--;
+
+        if ( begin == end )
+            return;
+
+        const char *field = begin;
+        while ( row.fieldCount < CSV_MAX_FIELDS )
+        {
+            const char *comma = (const char*)memchr( field, ',', end - field );
+            const char *fieldEnd = comma ? comma : end;
+
+            while ( field < fieldEnd && *field == ' ' )
+                field++;
+
+            row.fieldStart [ row.fieldCount ] = field - text;
+            row.fieldLength[ row.fieldCount ] = fieldEnd - field;
+            row.fieldCount++;
+
+            if ( !comma )
+                break;
+            field = comma + 1;
+        }
+
+        float numbers[3] = { 0, 0, 0 };
+        for (int i = 0; i < std::min( row.fieldCount, 3 ); i++)
+        {
+            const char *start = text + row.fieldStart[i];
+            numbers[i] = toFloat( start, start + row.fieldLength[i] );
+        }
+
+        row.lat   = numbers[0];
+        row.lon   = numbers[1];
+        row.value = numbers[2];
+    }
+
+    //--------------------------------------------------------------
+    inline size_t countLines( const char *begin, const char *end )
+    {
+        size_t lines = 0;
+        const char *p = begin;
+
+        while ( p < end && ( p = (const char*)memchr( p, '\n', end - p ) ) )
+        {
+            lines++;
+            p++;
+        }
+
+        // last line without a newline
+        if ( begin < end && end[-1] != '\n' )
+            lines++;
+
+        return lines;
+    }
+
+    //--------------------------------------------------------------
+    inline void parseRange( const char *text, const char *begin, const char *end, CsvRow *rows )
+    {
+        while ( begin < end )
+        {
+            const char *newline = (const char*)memchr( begin, '\n', end - begin );
+            const char *lineEnd = newline ? newline : end;
+
+            parseLine( text, begin, lineEnd, *rows++ );
+            begin = lineEnd + 1;
+        }
+    }
+
+    // Fills one row per line of data, logs the throughput under name
+    //--------------------------------------------------------------
+    inline void parse( const char *data, size_t size, vector<CsvRow> &rows, string name )
+    {
+        uint64_t start = ofGetElapsedTimeMicros();
+
+        // small files are not worth the threads
+        size_t threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+        threadCount = std::min( threadCount, size / ( 64 * 1024 ) + 1 );
+
+        // chunk boundaries moved forward to the next line start
+        vector<const char*> bounds( threadCount + 1 );
+        bounds[0] = data;
+        bounds[threadCount] = data + size;
+        for (size_t t = 1; t < threadCount; t++)
+        {
+            const char *p = std::max( data + size * t / threadCount, bounds[t - 1] );
+            const char *newline = (const char*)memchr( p, '\n', data + size - p );
+            bounds[t] = newline ? newline + 1 : data + size;
+        }
+
+        vector<size_t>      offsets( threadCount + 1, 0 );
+        vector<std::thread> threads;
+
+        for (size_t t = 0; t < threadCount; t++)
+            threads.push_back( std::thread( [&, t]() { offsets[t + 1] = countLines( bounds[t], bounds[t + 1] ); } ) );
+        for (size_t t = 0; t < threadCount; t++)
+            threads[t].join();
+
+        for (size_t t = 1; t <= threadCount; t++)
+            offsets[t] += offsets[t - 1];
+
+        rows.resize( offsets[threadCount] );
+        threads.clear();
+
+        for (size_t t = 0; t < threadCount; t++)
+            threads.push_back( std::thread( [&, t]() { parseRange( data, bounds[t], bounds[t + 1], rows.data() + offsets[t] ); } ) );
+        for (size_t t = 0; t < threadCount; t++)
+            threads[t].join();
+
+        uint64_t elapsed = std::max( (uint64_t)1, ofGetElapsedTimeMicros() - start );
+        ofLogNotice("CsvIngest") << name << ": " << rows.size() << " lines in " << elapsed / 1000 << "ms on "
+                                 << threadCount << " threads, " << uint64_t( rows.size() * 1000000.0 / elapsed ) << " lines/s";
+    }
+
+    //--------------------------------------------------------------
+    inline void parse( ofBuffer &file, vector<CsvRow> &rows, string name )
+    {
+        parse( file.getBinaryBuffer(), file.size(), rows, name );
+    }
+
+} // End of CsvIngest
@@ -0,0 +1,274 @@
+//
+//  DrawList.h
+//
+//  3/26/14.
+//
+//
+//  A frame as a list of draw commands. ColorWorld::compute() records what
+//  draw() used to call on GL right away, through the same kind of calls -
+//  a current color and fill, matrix pushes, lines, rects, boxes, labels -
+//  and submit() plays the list on GL. Recording needs no GL context, so
+//  the compute side runs and is timed headless.
+
+#pragma once
+
+#include "ofMain.h"
+#include "MapPixelBatch.h"
+
+enum DrawCommandType
+{
+    DRAW_BACKGROUND,        // circular gradient from color to the second color in args
+    DRAW_PUSH_MATRIX,
+    DRAW_POP_MATRIX,
+    DRAW_ROTATE,            // degrees, axis
+    DRAW_TRANSLATE,         // x, y, z
+    DRAW_LINE,              // x1, y1, z1, x2, y2, z2
+    DRAW_RECT,              // x, y, z, width, height
+    DRAW_BOX,               // x, y, z, width, height, depth
+    DRAW_LABEL,             // x, y, z, text at index
+    DRAW_IMAGE,             // x, y, width, height, image at index
+    DRAW_MAP_PIXELS         // filled batch at index
+};
+
+// One command, with the color and fill it is drawn with
+typedef struct DrawCommand
+{
+    uint8_t  type;
+    uint8_t  fill;
+    uint16_t padding;
+    ofColor  color;
+    float    args[6];
+    int32_t  index;
+} DrawCommand;
+
+
+class DrawList
+{
+public:
+
+    DrawList()
+    {
+        clear();
+    }
+
+    // Empties the list for the next frame, the memory is kept
+    //--------------------------------------------------------------
+    void clear()
+    {
+        m_commands.clear();
+        m_text.clear();
+        m_images.clear();
+        m_batches.clear();
+
+        m_color = ofColor( 255 );
+        m_fill  = true;
+    }
+
+    // State for the commands that follow, like ofSetColor / ofFill / ofNoFill
+    //--------------------------------------------------------------
+    void setColor( const ofColor &color )
+        { m_color = color; }
+
+    void setColor( const ofColor &color, float alpha )
+        { m_color = ofColor( color, alpha ); }
+
+    void setColor( float r, float g, float b, float a = 255 )
+        { m_color = ofColor( r, g, b, a ); }
+
+    void fill()
+        { m_fill = true; }
+
+    void noFill()
+        { m_fill = false; }
+
+    //--------------------------------------------------------------
+    void background( const ofColor &start, const ofColor &end )
+    {
+        DrawCommand &command = add( DRAW_BACKGROUND );
+        command.color   = start;
+        command.args[0] = end.r;
+        command.args[1] = end.g;
+        command.args[2] = end.b;
+        command.args[3] = end.a;
+    }
+
+    //--------------------------------------------------------------
+    void pushMatrix()
+        { add( DRAW_PUSH_MATRIX ); }
+
+    void popMatrix()
+        { add( DRAW_POP_MATRIX ); }
+
+    void rotate( float degrees, float x, float y, float z )
+        { set( add( DRAW_ROTATE ), degrees, x, y, z ); }
+
+    void translate( float x, float y, float z = 0 )
+        { set( add( DRAW_TRANSLATE ), x, y, z ); }
+
+    //--------------------------------------------------------------
+    void line( float x1, float y1, float z1, float x2, float y2, float z2 )
+        { set( add( DRAW_LINE ), x1, y1, z1, x2, y2, z2 ); }
+
+    void rect( float x, float y, float z, float width, float height )
+        { set( add( DRAW_RECT ), x, y, z, width, height ); }
+
+    void box( float x, float y, float z, float width, float height, float depth )
+        { set( add( DRAW_BOX ), x, y, z, width, height, depth ); }
+
+    // The text is copied into the list
+    //--------------------------------------------------------------
+    void label( const string &text, float x, float y, float z = 0 )
+    {
+        DrawCommand &command = add( DRAW_LABEL );
+        set( command, x, y, z );
+        command.index = m_text.size();
+        m_text.insert( m_text.end(), text.c_str(), text.c_str() + text.size() + 1 );
+    }
+
+    // image has to stay valid until submit()
+    //--------------------------------------------------------------
+    void image( ofBaseDraws *image, float x, float y, float width, float height )
+    {
+        DrawCommand &command = add( DRAW_IMAGE );
+        set( command, x, y, width, height );
+        command.index = m_images.size();
+        m_images.push_back( image );
+    }
+
+    // A batch already filled, it has to stay untouched until submit()
+    //--------------------------------------------------------------
+    void mapPixels( MapPixelBatch &batch )
+    {
+        DrawCommand &command = add( DRAW_MAP_PIXELS );
+        command.index = m_batches.size();
+        m_batches.push_back( &batch );
+    }
+
+    // Plays the list on GL - main thread. Color and fill are only set when they change.
+    //--------------------------------------------------------------
+    void submit() const
+    {
+        ofColor color( 255 );
+        bool    fill = true;
+        ofSetColor( color );
+        ofFill();
+
+        for (size_t i = 0; i < m_commands.size(); i++)
+        {
+            const DrawCommand &command = m_commands[i];
+            const float       *a       = command.args;
+
+            if ( command.type >= DRAW_LINE && command.color != color )
+            {
+                color = command.color;
+                ofSetColor( color );
+            }
+            if ( command.type >= DRAW_LINE && command.fill != fill )
+            {
+                fill = command.fill;
+                if ( fill )
+                    ofFill();
+                else
+                    ofNoFill();
+            }
+
+            switch ( command.type )
+            {
+                case DRAW_BACKGROUND:
+                    ofBackgroundGradient( command.color, ofColor( a[0], a[1], a[2], a[3] ), OF_GRADIENT_CIRCULAR );
+                    ofSetColor( color );
+                    break;
+
+                case DRAW_PUSH_MATRIX:
+                    ofPushMatrix();
+                    break;
+
+                case DRAW_POP_MATRIX:
+                    ofPopMatrix();
+                    break;
+
+                case DRAW_ROTATE:
+                    ofRotate( a[0], a[1], a[2], a[3] );
+                    break;
+
+                case DRAW_TRANSLATE:
+                    ofTranslate( a[0], a[1], a[2] );
+                    break;
+
+                case DRAW_LINE:
+                    ofLine( a[0], a[1], a[2], a[3], a[4], a[5] );
+                    break;
+
+                case DRAW_RECT:
+                    ofRect( a[0], a[1], a[2], a[3], a[4] );
+                    break;
+
+                case DRAW_BOX:
+                    ofBox( a[0], a[1], a[2], a[3], a[4], a[5] );
+                    break;
+
+                case DRAW_LABEL:
+                    ofDrawBitmapString( &m_text[ command.index ], a[0], a[1], a[2] );
+                    break;
+
+                case DRAW_IMAGE:
+                    m_images[ command.index ]->draw( a[0], a[1], a[2], a[3] );
+                    break;
+
+                case DRAW_MAP_PIXELS:
+                    m_batches[ command.index ]->draw();
+                    break;
+            }
+        }
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_commands.size(); }
+
+    // Bytes of commands and label text this frame
+    //--------------------------------------------------------------
+    size_t getNumBytes() const
+        { return m_commands.size() * sizeof(DrawCommand) + m_text.size(); }
+
+    //--------------------------------------------------------------
+    const vector<DrawCommand>& getCommands() const
+        { return m_commands; }
+
+private:
+
+    //--------------------------------------------------------------
+    DrawCommand& add( DrawCommandType type )
+    {
+        m_commands.push_back( DrawCommand() );
+
+        DrawCommand &command = m_commands.back();
+        command.type    = type;
+        command.fill    = m_fill;
+        command.padding = 0;
+        command.color   = m_color;
+        command.index   = -1;
+        set( command );
+        return command;
+    }
+
+    //--------------------------------------------------------------
+    static void set( DrawCommand &command, float a0 = 0, float a1 = 0, float a2 = 0,
+                                           float a3 = 0, float a4 = 0, float a5 = 0 )
+    {
+        command.args[0] = a0;
+        command.args[1] = a1;
+        command.args[2] = a2;
+        command.args[3] = a3;
+        command.args[4] = a4;
+        command.args[5] = a5;
+    }
+
+    vector<DrawCommand>     m_commands;
+    vector<char>            m_text;         // labels, null terminated
+    vector<ofBaseDraws*>    m_images;
+    vector<MapPixelBatch*>  m_batches;
+
+    ofColor                 m_color;
+    bool                    m_fill;
+};
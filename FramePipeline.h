@@ -0,0 +1,319 @@
+//
+//  FramePipeline.h
+//
+//  3/26/14.
+//
+//
+//  The map part of a frame prepared on a worker thread, one frame ahead.
+//  update() takes the frame prepared from the last view and submits the
+//  current one, so the worker culls, projects, shades and expands the map
+//  pixels of frame N+1 while the main thread draws frame N. Two slots: the
+//  one shown and the one being prepared. take() waits for the worker when
+//  it is late, so what is drawn is never more than one frame behind the
+//  input, and every wait is counted as a stall.
+//  Without start() the same happens in place, on the main thread.
+//  With a TaskPool the worker splits the projection and the map pixels
+//  over the pool's threads.
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ofMain.h"
+#include "GeoGrid.h"
+#include "CityPointStore.h"
+#include "MercatorProjector.h"
+#include "VisibleSet.h"
+#include "ScreenGrid.h"
+#include "MapPixelKernel.h"
+#include "MapPixelBatch.h"
+#include "TaskPool.h"
+
+// fewest map pixels a thread computes and expands
+#define FRAMEPIPELINE_GRAIN 4096
+
+// The view a frame is prepared for, taken on the main thread. grid and
+// points are read on the worker and have to stay unchanged.
+typedef struct FrameRequest
+{
+    const GeoGrid          *grid;
+    const CityPointStore   *points;
+    MercatorProjector       projector;
+    double                  latitude;
+    double                  longitude;
+    double                  latRange;
+    double                  lonRange;
+    int                     generation;     // changed when grid and points are others
+    bool                    cacheColors;    // cacheColor over displayColor
+} FrameRequest;
+
+// What draw() needs of the map, owned by the main thread once taken
+typedef struct PreparedFrame
+{
+    FrameRequest    request;
+    VisibleSet      visibleSet;
+    ScreenGrid      screenGrid;     // finger hit test
+    MapPixelBatch   mapPixels;      // filled
+    int             generation;     // of the request visibleSet was last updated for
+    uint64_t        prepareTime;    // microseconds on the worker
+} PreparedFrame;
+
+
+class FramePipeline
+{
+public:
+
+    FramePipeline()
+    {
+        m_running  = false;
+        m_pending  = false;
+        m_ready    = false;
+        m_inFlight = false;
+        m_front    = 0;
+        m_pool     = NULL;
+
+        m_numFrames      = 0;
+        m_numStalls      = 0;
+        m_stallMicros    = 0;
+        m_maxStallMicros = 0;
+        m_prepareMicros  = 0;
+
+        for (int i = 0; i < 2; i++)
+        {
+            m_slots[i].request.grid   = NULL;
+            m_slots[i].request.points = NULL;
+            m_slots[i].generation     = -1;
+            m_slots[i].prepareTime    = 0;
+        }
+    }
+
+    ~FramePipeline()
+    {
+        stop();
+    }
+
+    // Starts the worker
+    //--------------------------------------------------------------
+    void start()
+    {
+        stop();
+
+        m_running = true;
+        m_worker  = std::thread( &FramePipeline::work, this );
+    }
+
+    // Joins the worker, a frame in flight is finished first
+    //--------------------------------------------------------------
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_running = false;
+        }
+        m_wake.notify_all();
+
+        if ( m_worker.joinable() )
+            m_worker.join();
+    }
+
+    // Pool prepare() splits its loops over, NULL for none. Set before start().
+    //--------------------------------------------------------------
+    void setTaskPool( TaskPool *pool )
+        { m_pool = pool; }
+
+    // Main thread - the frame prepared from the last submit(), waits for
+    // the worker if it is not done. An empty frame before the first submit().
+    //--------------------------------------------------------------
+    PreparedFrame& take()
+    {
+        if ( !m_inFlight )
+            return m_slots[m_front];
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            if ( !m_ready )
+            {
+                uint64_t start = ofGetElapsedTimeMicros();
+                while ( !m_ready )
+                    m_done.wait( lock );
+
+                uint64_t stall = ofGetElapsedTimeMicros() - start;
+                m_numStalls++;
+                m_stallMicros   += stall;
+                m_maxStallMicros = std::max( m_maxStallMicros, stall );
+            }
+            m_ready = false;
+        }
+
+        m_inFlight = false;
+        m_front    = 1 - m_front;
+        m_numFrames++;
+        m_prepareMicros += m_slots[m_front].prepareTime;
+
+        return m_slots[m_front];
+    }
+
+    // Main thread - prepares the frame for request in the slot not shown,
+    // on the worker if started. Every submit() is followed by a take().
+    //--------------------------------------------------------------
+    void submit( const FrameRequest &request )
+    {
+        PreparedFrame &back = m_slots[1 - m_front];
+        back.request = request;
+        m_inFlight   = true;
+
+        if ( !m_running )
+        {
+            prepare( back, m_pool );
+            m_ready = true;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_pending = true;
+        }
+        m_wake.notify_one();
+    }
+
+    //--------------------------------------------------------------
+    bool isThreaded() const
+        { return m_running; }
+
+    // Frames taken
+    //--------------------------------------------------------------
+    size_t getNumFrames() const
+        { return m_numFrames; }
+
+    // Frames the main thread had to wait for
+    //--------------------------------------------------------------
+    size_t getNumStalls() const
+        { return m_numStalls; }
+
+    //--------------------------------------------------------------
+    uint64_t getStallMicros() const
+        { return m_stallMicros; }
+
+    //--------------------------------------------------------------
+    uint64_t getMaxStallMicros() const
+        { return m_maxStallMicros; }
+
+    //--------------------------------------------------------------
+    float getAveragePrepareTime() const
+        { return m_numFrames ? (float)m_prepareMicros / m_numFrames : 0; }
+
+    //--------------------------------------------------------------
+    void resetCounters()
+    {
+        m_numFrames      = 0;
+        m_numStalls      = 0;
+        m_stallMicros    = 0;
+        m_maxStallMicros = 0;
+        m_prepareMicros  = 0;
+    }
+
+    // Visible set, hit test grid, pixel attributes and the filled map
+    // pixels for the frame's request - either thread
+    //--------------------------------------------------------------
+    static void prepare( PreparedFrame &frame, TaskPool *pool = NULL )
+    {
+        uint64_t start = ofGetElapsedTimeMicros();
+        const FrameRequest &request = frame.request;
+
+        // the set is incremental, only over the same points
+        if ( frame.generation != request.generation )
+        {
+            frame.visibleSet.invalidate();
+            frame.generation = request.generation;
+        }
+
+        VisibleSet &visible = frame.visibleSet;
+        visible.update( *request.grid, *request.points, request.projector,
+                        request.latitude, request.longitude, request.latRange, request.lonRange, pool );
+
+        // hit test in the set's positions, without its offset
+        frame.screenGrid.build( visible.pixels.x.data(), visible.pixels.y.data(), visible.ids.size() );
+
+        ofPoint center = request.projector.getCenter();
+
+        // the cache toggle only picks the precomputed color column
+        const vector<ofColor> &colors = request.cacheColors ? request.points->cacheColor
+                                                            : request.points->displayColor;
+
+        // attributes and the instance record of a range in one pass, while it is in cache
+        MapPixelBatch &batch = frame.mapPixels;
+        batch.resize( visible.ids.size() );
+
+        TaskRange range = [&]( size_t begin, size_t end )
+        {
+            MapPixelKernel::compute( visible.pixels, center.x - visible.offset.x, center.y - visible.offset.y, begin, end );
+
+            for (size_t i = begin; i < end; i++)
+            {
+                batch.set( i, visible.pixels.x[i] + visible.offset.x, visible.pixels.y[i] + visible.offset.y, visible.pixels.z[i],
+                           visible.pixels.radius[i], colors[ visible.ids[i] ], visible.pixels.alpha[i] );
+            }
+        };
+
+        if ( pool )
+            pool->parallelFor( "map pixels", visible.ids.size(), FRAMEPIPELINE_GRAIN, range );
+        else
+            range( 0, visible.ids.size() );
+
+        frame.prepareTime = ofGetElapsedTimeMicros() - start;
+    }
+
+private:
+
+    //--------------------------------------------------------------
+    void work()
+    {
+        while ( true )
+        {
+            PreparedFrame *frame;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                while ( m_running && !m_pending )
+                    m_wake.wait( lock );
+
+                if ( !m_pending )
+                    return;
+
+                m_pending = false;
+                frame     = &m_slots[1 - m_front];
+            }
+
+            prepare( *frame, m_pool );
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_ready = true;
+            }
+            m_done.notify_one();
+        }
+    }
+
+    PreparedFrame               m_slots[2];
+
+    // shared with the worker
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    std::condition_variable     m_done;
+    std::thread                 m_worker;
+    bool                        m_running;
+    bool                        m_pending;
+    bool                        m_ready;
+
+    // main thread only
+    bool                        m_inFlight;
+    int                         m_front;        // slot shown, the worker reads it under the lock
+    TaskPool                   *m_pool;
+
+    size_t                      m_numFrames;
+    size_t                      m_numStalls;
+    uint64_t                    m_stallMicros;
+    uint64_t                    m_maxStallMicros;
+    uint64_t                    m_prepareMicros;
+};
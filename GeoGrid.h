@@ -0,0 +1,216 @@
+//
+//  GeoGrid.h
+//
+//  3/26/14.
+//
+//
+//  Uniform lat/lon grid over the city points.
+//  Built once after loading, a window query only visits the cells
+//  that overlap the window instead of scanning every point.
+
+#pragma once
+
+#include "ofMain.h"
+
+class GeoGrid
+{
+public:
+
+    GeoGrid()
+    {
+        clear();
+    }
+
+    //--------------------------------------------------------------
+    void clear()
+    {
+        m_minLat   = 0;
+        m_minLon   = 0;
+        m_cellSize = 1;
+        m_rows     = 0;
+        m_cols     = 0;
+
+        m_cellStart.clear();
+        m_ids.clear();
+        m_lat.clear();
+        m_lon.clear();
+    }
+
+    // cellSize is in degrees, it is doubled until the cell table
+    // stays proportional to the number of points
+    //--------------------------------------------------------------
+    void build( const vector<float> &latitude, const vector<float> &longitude, double cellSize = 0.005 )
+    {
+        clear();
+
+        size_t n = latitude.size();
+        if ( n == 0 )
+            return;
+
+        double minLat = latitude[0],  maxLat = minLat;
+        double minLon = longitude[0], maxLon = minLon;
+
+        for (size_t i = 1; i < n; i++)
+        {
+            minLat = std::min( minLat, (double)latitude[i] );
+            maxLat = std::max( maxLat, (double)latitude[i] );
+            minLon = std::min( minLon, (double)longitude[i] );
+            maxLon = std::max( maxLon, (double)longitude[i] );
+        }
+
+        double maxCells = std::max( (double)n * 2, 1024.0 );
+        while ( ( (maxLat - minLat) / cellSize + 1 ) * ( (maxLon - minLon) / cellSize + 1 ) > maxCells )
+            cellSize *= 2;
+
+        m_minLat   = minLat;
+        m_minLon   = minLon;
+        m_cellSize = cellSize;
+        m_rows     = int( (maxLat - minLat) / cellSize ) + 1;
+        m_cols     = int( (maxLon - minLon) / cellSize ) + 1;
+
+        // counting sort of point ids by cell, ids stay ascending inside a cell
+        vector<int> cellOf( n );
+        m_cellStart.assign( (size_t)m_rows * m_cols + 1, 0 );
+
+        for (size_t i = 0; i < n; i++)
+        {
+            cellOf[i] = rowOf( latitude[i] ) * m_cols + colOf( longitude[i] );
+            m_cellStart[ cellOf[i] + 1 ]++;
+        }
+
+        for (size_t c = 1; c < m_cellStart.size(); c++)
+            m_cellStart[c] += m_cellStart[c - 1];
+
+        vector<int> next( m_cellStart.begin(), m_cellStart.end() - 1 );
+        m_ids.resize( n );
+        m_lat.resize( n );
+        m_lon.resize( n );
+
+        for (size_t i = 0; i < n; i++)
+        {
+            int slot = next[ cellOf[i] ]++;
+            m_ids[slot] = i;
+            m_lat[slot] = latitude[i];
+            m_lon[slot] = longitude[i];
+        }
+    }
+
+    // Appends ids of points with minLat <= lat < maxLat and minLon <= lon < maxLon
+    //--------------------------------------------------------------
+    void query( double minLat, double maxLat, double minLon, double maxLon, vector<int> &ids ) const
+    {
+        if ( m_ids.empty() )
+            return;
+
+        if ( maxLat < m_minLat || maxLon < m_minLon ||
+             minLat >= m_minLat + m_rows * m_cellSize ||
+             minLon >= m_minLon + m_cols * m_cellSize )
+            return;
+
+        int r0 = rowOf( minLat ), r1 = rowOf( maxLat );
+        int c0 = colOf( minLon ), c1 = colOf( maxLon );
+
+        for (int r = r0; r <= r1; r++)
+        {
+            // cells of one row are contiguous in the sorted arrays
+            int begin = m_cellStart[ r * m_cols + c0 ];
+            int end   = m_cellStart[ r * m_cols + c1 + 1 ];
+
+            for (int k = begin; k < end; k++)
+            {
+                double lat = m_lat[k];
+                double lon = m_lon[k];
+
+                if ( lat <  maxLat && lon <  maxLon &&
+                     lat >= minLat && lon >= minLon )
+                {
+                    ids.push_back( m_ids[k] );
+                }
+            }
+        }
+    }
+
+    // Restores a grid saved with the accessors below, the points are
+    // the same arrays the grid was built from
+    //--------------------------------------------------------------
+    void load( double minLat, double minLon, double cellSize, int rows, int cols,
+               const int *cellStart, const int *ids,
+               const vector<float> &latitude, const vector<float> &longitude )
+    {
+        clear();
+
+        m_minLat   = minLat;
+        m_minLon   = minLon;
+        m_cellSize = cellSize;
+        m_rows     = rows;
+        m_cols     = cols;
+
+        m_cellStart.assign( cellStart, cellStart + (size_t)rows * cols + 1 );
+        m_ids.assign( ids, ids + latitude.size() );
+        m_lat.resize( m_ids.size() );
+        m_lon.resize( m_ids.size() );
+
+        for (size_t k = 0; k < m_ids.size(); k++)
+        {
+            m_lat[k] = latitude [ m_ids[k] ];
+            m_lon[k] = longitude[ m_ids[k] ];
+        }
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_ids.size(); }
+
+    //--------------------------------------------------------------
+    double getMinLatitude() const
+        { return m_minLat; }
+
+    //--------------------------------------------------------------
+    double getMinLongitude() const
+        { return m_minLon; }
+
+    //--------------------------------------------------------------
+    double getCellSize() const
+        { return m_cellSize; }
+
+    //--------------------------------------------------------------
+    int getRows() const
+        { return m_rows; }
+
+    //--------------------------------------------------------------
+    int getCols() const
+        { return m_cols; }
+
+    //--------------------------------------------------------------
+    const vector<int>& getCellStarts() const
+        { return m_cellStart; }
+
+    //--------------------------------------------------------------
+    const vector<int>& getIds() const
+        { return m_ids; }
+
+    //--------------------------------------------------------------
+    int getNumCells() const
+        { return m_rows * m_cols; }
+
+private:
+
+    //--------------------------------------------------------------
+    int rowOf( double lat ) const
+        { return std::max( 0, std::min( int( floor( (lat - m_minLat) / m_cellSize ) ), m_rows - 1 ) ); }
+
+    //--------------------------------------------------------------
+    int colOf( double lon ) const
+        { return std::max( 0, std::min( int( floor( (lon - m_minLon) / m_cellSize ) ), m_cols - 1 ) ); }
+
+    double m_minLat;
+    double m_minLon;
+    double m_cellSize;
+    int    m_rows;
+    int    m_cols;
+
+    vector<int>   m_cellStart;  // rows * cols + 1 offsets into m_ids
+    vector<int>   m_ids;        // point ids sorted by cell
+    vector<float> m_lat;        // coordinates in the same order as m_ids
+    vector<float> m_lon;
+};
@@ -0,0 +1,204 @@
+//
+//  GeoKey.h
+//
+//  3/26/14.
+//
+//
+//  Packed integer lat/lon keys and a flat open-addressing table keyed by them.
+//  Replaces the "lat,lon" string keys - no formatting or allocation per lookup,
+//  and every loader quantizes the same float the same way.
+
+#pragma once
+
+#include "ofMain.h"
+
+// 1e-6 degree steps - about 10cm, finer than float precision at city latitudes
+#define GEOKEY_SCALE 1000000.0
+
+typedef uint64_t GeoKey;
+
+// latitude in the high 32 bits, longitude in the low 32 bits
+//--------------------------------------------------------------
+inline GeoKey makeGeoKey( double lat, double lon )
+{
+    uint64_t qlat = (uint64_t)llround( (lat +  90.0) * GEOKEY_SCALE );
+    uint64_t qlon = (uint64_t)llround( (lon + 180.0) * GEOKEY_SCALE );
+
+    return ( qlat << 32 ) | qlon;
+}
+
+//--------------------------------------------------------------
+inline double geoKeyLatitude( GeoKey key )
+{
+    return double( key >> 32 ) / GEOKEY_SCALE - 90.0;
+}
+
+//--------------------------------------------------------------
+inline double geoKeyLongitude( GeoKey key )
+{
+    return double( key & 0xffffffffULL ) / GEOKEY_SCALE - 180.0;
+}
+
+
+// Linear probing, power of two capacity, kept at most half full
+template <class T>
+class GeoKeyMap
+{
+public:
+
+    GeoKeyMap() : m_default()
+    {
+        clear();
+    }
+
+    //--------------------------------------------------------------
+    void clear()
+    {
+        m_size = 0;
+        m_keys.assign( 16, EMPTY_KEY );
+        m_values.assign( 16, T() );
+    }
+
+    //--------------------------------------------------------------
+    void reserve( size_t count )
+    {
+        size_t capacity = m_keys.size();
+        while ( capacity < count * 2 )
+            capacity *= 2;
+
+        if ( capacity != m_keys.size() )
+            rehash( capacity );
+    }
+
+    // Inserts a default value when the key is missing, like std::map
+    //--------------------------------------------------------------
+    T& operator[]( GeoKey key )
+    {
+        size_t slot = probe( key );
+        if ( m_keys[slot] == key )
+            return m_values[slot];
+
+        if ( ( m_size + 1 ) * 2 > m_keys.size() )
+        {
+            rehash( m_keys.size() * 2 );
+            slot = probe( key );
+        }
+
+        m_keys[slot] = key;
+        m_size++;
+        return m_values[slot];
+    }
+
+    //--------------------------------------------------------------
+    const T* find( GeoKey key ) const
+    {
+        size_t slot = probe( key );
+        return m_keys[slot] == key ? &m_values[slot] : NULL;
+    }
+
+    //--------------------------------------------------------------
+    T* find( GeoKey key )
+    {
+        size_t slot = probe( key );
+        return m_keys[slot] == key ? &m_values[slot] : NULL;
+    }
+
+    // Read-only lookup, a default value for missing keys and nothing inserted
+    //--------------------------------------------------------------
+    const T& get( GeoKey key ) const
+    {
+        const T* value = find( key );
+        return value ? *value : m_default;
+    }
+
+    // Removes key, shifting the rest of its probe run back so lookups
+    // never stop early - no tombstones
+    //--------------------------------------------------------------
+    bool erase( GeoKey key )
+    {
+        size_t hole = probe( key );
+        if ( m_keys[hole] != key )
+            return false;
+
+        size_t mask = m_keys.size() - 1;
+        for (size_t next = ( hole + 1 ) & mask; m_keys[next] != EMPTY_KEY; next = ( next + 1 ) & mask)
+        {
+            // an entry may fill the hole if the hole lies between its home slot and its slot
+            size_t home = hash( m_keys[next] ) & mask;
+            if ( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) )
+            {
+                m_keys[hole] = m_keys[next];
+                std::swap( m_values[hole], m_values[next] );
+                hole = next;
+            }
+        }
+
+        m_keys[hole]   = EMPTY_KEY;
+        m_values[hole] = T();
+        m_size--;
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_size; }
+
+    //--------------------------------------------------------------
+    bool empty() const
+        { return m_size == 0; }
+
+private:
+
+    // never produced by makeGeoKey
+    static const GeoKey EMPTY_KEY = ~0ULL;
+
+    //--------------------------------------------------------------
+    static size_t hash( GeoKey key )
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return (size_t)key;
+    }
+
+    // slot holding key, or the empty slot where it would go
+    //--------------------------------------------------------------
+    size_t probe( GeoKey key ) const
+    {
+        size_t mask = m_keys.size() - 1;
+        size_t slot = hash( key ) & mask;
+
+        while ( m_keys[slot] != key && m_keys[slot] != EMPTY_KEY )
+            slot = ( slot + 1 ) & mask;
+
+        return slot;
+    }
+
+    //--------------------------------------------------------------
+    void rehash( size_t capacity )
+    {
+        vector<GeoKey> keys( capacity, EMPTY_KEY );
+        vector<T>      values( capacity );
+
+        m_keys.swap( keys );
+        m_values.swap( values );
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if ( keys[i] == EMPTY_KEY )
+                continue;
+
+            size_t slot = probe( keys[i] );
+            m_keys[slot] = keys[i];
+            std::swap( m_values[slot], values[i] );
+        }
+    }
+
+    size_t          m_size;
+    vector<GeoKey>  m_keys;
+    vector<T>       m_values;
+    T               m_default;  // what get() returns for missing keys
+};
+
+template <class T>
+const GeoKey GeoKeyMap<T>::EMPTY_KEY;
@@ -0,0 +1,123 @@
+//
+//  KdTree.h
+//
+//  3/26/14.
+//
+//
+//  Static 2d k-d tree for nearest point queries.
+//  Built once at load time, stored implicitly in one array: the median of
+//  [lo, hi) is the node, the halves on each side are its subtrees.
+
+#pragma once
+
+#include "ofMain.h"
+
+class KdTree
+{
+public:
+
+    //--------------------------------------------------------------
+    void build( const vector<float> &x, const vector<float> &y )
+    {
+        size_t count = x.size();
+
+        m_ids.resize( count );
+        for (size_t i = 0; i < count; i++)
+            m_ids[i] = i;
+
+        m_x = x;
+        m_y = y;
+        split( 0, count, 0 );
+
+        // coordinates in tree order for the queries
+        m_x.resize( count );
+        m_y.resize( count );
+        for (size_t k = 0; k < count; k++)
+        {
+            m_x[k] = x[ m_ids[k] ];
+            m_y[k] = y[ m_ids[k] ];
+        }
+    }
+
+    // Id of the point closest to (qx, qy), -1 for an empty tree
+    //--------------------------------------------------------------
+    int nearest( float qx, float qy ) const
+    {
+        if ( m_ids.empty() )
+            return -1;
+
+        int   best     = 0;
+        float bestDist = FLT_MAX;
+        search( 0, m_ids.size(), 0, qx, qy, best, bestDist );
+
+        return m_ids[best];
+    }
+
+    // Same for count queries at once
+    //--------------------------------------------------------------
+    void nearest( const float *qx, const float *qy, size_t count, int *ids ) const
+    {
+        for (size_t i = 0; i < count; i++)
+            ids[i] = nearest( qx[i], qy[i] );
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_ids.size(); }
+
+private:
+
+    //--------------------------------------------------------------
+    void split( int lo, int hi, int depth )
+    {
+        if ( hi - lo <= 1 )
+            return;
+
+        int mid = ( lo + hi ) / 2;
+        const vector<float> &axis = depth % 2 ? m_y : m_x;
+
+        std::nth_element( m_ids.begin() + lo, m_ids.begin() + mid, m_ids.begin() + hi,
+                          [&axis]( int a, int b ) { return axis[a] < axis[b]; } );
+
+        split( lo, mid, depth + 1 );
+        split( mid + 1, hi, depth + 1 );
+    }
+
+    //--------------------------------------------------------------
+    void search( int lo, int hi, int depth, float qx, float qy, int &best, float &bestDist ) const
+    {
+        if ( lo >= hi )
+            return;
+
+        int mid = ( lo + hi ) / 2;
+
+        float dx = qx - m_x[mid];
+        float dy = qy - m_y[mid];
+        float dist = dx * dx + dy * dy;
+        if ( dist < bestDist )
+        {
+            bestDist = dist;
+            best     = mid;
+        }
+
+        float diff = depth % 2 ? dy : dx;
+
+        // nearer side first, the other one only if it can still hold a closer point
+        if ( diff < 0 )
+        {
+            search( lo, mid, depth + 1, qx, qy, best, bestDist );
+            if ( diff * diff < bestDist )
+                search( mid + 1, hi, depth + 1, qx, qy, best, bestDist );
+        }
+        else
+        {
+            search( mid + 1, hi, depth + 1, qx, qy, best, bestDist );
+            if ( diff * diff < bestDist )
+                search( lo, mid, depth + 1, qx, qy, best, bestDist );
+        }
+    }
+
+    vector<int>   m_ids;    // point ids in tree order
+    vector<float> m_x;      // coordinates in tree order
+    vector<float> m_y;
+};
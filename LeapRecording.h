@@ -0,0 +1,441 @@
+//
+//  LeapRecording.h
+//
+//  3/26/14.
+//
+//
+//  Leap sessions recorded to a file and played back in place of the device.
+//  A recording holds what the app read every frame - the simple hands, the
+//  gesture events and the last gesture - so a playback drives update()
+//  exactly like the live session did, on a machine without a Leap.
+//
+//  Layout, native little endian:
+//      LeapRecordingHeader
+//      per frame:  LeapRecordingFrame, then its LeapRecordingHand records each
+//                  followed by its LeapRecordingFinger records, then its
+//                  LeapRecordingEvent records
+
+#pragma once
+
+#include <fstream>
+
+#include "ofMain.h"
+#include "MappedFile.h"
+#include "LeapSimpleHands.h"
+
+#define LEAPRECORDING_MAGIC   0x524c5743    // "CWLR"
+#define LEAPRECORDING_VERSION 1
+
+typedef struct LeapRecordingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+} LeapRecordingHeader;
+
+typedef struct LeapRecordingFrame
+{
+    uint64_t time;          // microseconds since the recording started
+    int32_t  gesture;       // iGestures after the frame
+    uint8_t  numHands;
+    uint8_t  numEvents;
+    uint16_t padding;
+} LeapRecordingFrame;
+
+typedef struct LeapRecordingHand
+{
+    float    position[3];
+    float    normal[3];
+    uint32_t numFingers;
+} LeapRecordingHand;
+
+typedef struct LeapRecordingFinger
+{
+    float    position[3];
+    float    velocity[3];
+    int64_t  id;
+} LeapRecordingFinger;
+
+typedef struct LeapRecordingEvent
+{
+    int32_t  type;
+    int32_t  padding;
+    int64_t  frameId;
+    int64_t  timestamp;
+    float    position[3];
+    uint32_t padding2;
+} LeapRecordingEvent;
+
+
+// Writes one frame per record() call, buffered so a frame costs no system call
+class LeapRecorder
+{
+public:
+
+    LeapRecorder()
+    {
+        m_numFrames = 0;
+        m_start     = 0;
+    }
+
+    ~LeapRecorder()
+    {
+        close();
+    }
+
+    // path goes through ofToDataPath
+    //--------------------------------------------------------------
+    bool open( string filename )
+    {
+        close();
+
+        m_file.open( ofToDataPath( filename ).c_str(), ios::binary );
+        if ( !m_file )
+        {
+            ofLogError("LeapRecorder") << "could not write " << filename;
+            return false;
+        }
+
+        LeapRecordingHeader header;
+        header.magic   = LEAPRECORDING_MAGIC;
+        header.version = LEAPRECORDING_VERSION;
+        m_file.write( (const char*)&header, sizeof(header) );
+
+        m_numFrames = 0;
+        m_start     = ofGetElapsedTimeMicros();
+        return true;
+    }
+
+    // What update() read from source this frame, nothing when not open
+    //--------------------------------------------------------------
+    void record( const ofxLeapMotionSource &source, const ofxLeapMotionSimpleHands &hands )
+    {
+        if ( !m_file.is_open() )
+            return;
+
+        const vector<ofxLeapMotionGestureEvent> &events = source.getGestureEvents();
+
+        LeapRecordingFrame frame;
+        frame.time      = ofGetElapsedTimeMicros() - m_start;
+        frame.gesture   = source.iGestures;
+        frame.numHands  = hands.size();
+        frame.numEvents = std::min( events.size(), (size_t)255 );
+        frame.padding   = 0;
+        append( frame );
+
+        for (int i = 0; i < hands.size(); i++)
+        {
+            LeapRecordingHand hand;
+            copy( hand.position, hands[i].handPos );
+            copy( hand.normal,   hands[i].handNormal );
+            hand.numFingers = hands[i].fingers.size();
+            append( hand );
+
+            for (int k = 0; k < hands[i].fingers.size(); k++)
+            {
+                LeapRecordingFinger finger;
+                copy( finger.position, hands[i].fingers[k].pos );
+                copy( finger.velocity, hands[i].fingers[k].vel );
+                finger.id = hands[i].fingers[k].id;
+                append( finger );
+            }
+        }
+
+        for (int i = 0; i < frame.numEvents; i++)
+        {
+            LeapRecordingEvent event;
+            event.type      = events[i].type;
+            event.padding   = 0;
+            event.frameId   = events[i].frameId;
+            event.timestamp = events[i].timestamp;
+            event.padding2  = 0;
+            copy( event.position, events[i].position );
+            append( event );
+        }
+
+        m_numFrames++;
+        if ( m_buffer.size() > ( 64 << 10 ) )
+            flush();
+    }
+
+    //--------------------------------------------------------------
+    void close()
+    {
+        if ( !m_file.is_open() )
+            return;
+
+        flush();
+        m_file.close();
+    }
+
+    //--------------------------------------------------------------
+    bool isRecording() const
+        { return m_file.is_open(); }
+
+    //--------------------------------------------------------------
+    size_t getNumFrames() const
+        { return m_numFrames; }
+
+private:
+
+    //--------------------------------------------------------------
+    static void copy( float *out, const ofPoint &p )
+    {
+        out[0] = p.x;
+        out[1] = p.y;
+        out[2] = p.z;
+    }
+
+    //--------------------------------------------------------------
+    template <class T>
+    void append( const T &record )
+    {
+        const char *bytes = (const char*)&record;
+        m_buffer.insert( m_buffer.end(), bytes, bytes + sizeof(T) );
+    }
+
+    //--------------------------------------------------------------
+    void flush()
+    {
+        if ( !m_buffer.empty() )
+            m_file.write( &m_buffer[0], m_buffer.size() );
+        m_buffer.clear();
+    }
+
+    ofstream        m_file;
+    vector<char>    m_buffer;
+    size_t          m_numFrames;
+    uint64_t        m_start;
+};
+
+
+// A recording as the Leap source of the app - in real time, frames are
+// picked by their recorded time and the gesture events of skipped frames
+// are still delivered; or as fast as possible, one frame per update
+class LeapReplay : public ofxLeapMotionSource
+{
+public:
+
+    LeapReplay()
+    {
+        m_realTime = true;
+        m_loop     = false;
+        m_current  = -1;
+        m_next     = 0;
+        m_start    = 0;
+    }
+
+    // Maps the recording, false if it is missing, from another version or truncated
+    //--------------------------------------------------------------
+    bool load( string filename, bool realTime = true, bool loop = false )
+    {
+        m_frames.clear();
+        if ( !m_file.open( filename ) || m_file.size() < sizeof(LeapRecordingHeader) )
+            return false;
+
+        LeapRecordingHeader header;
+        memcpy( &header, m_file.data(), sizeof(header) );
+        if ( header.magic != LEAPRECORDING_MAGIC || header.version != LEAPRECORDING_VERSION )
+        {
+            ofLogError("LeapReplay") << filename << " is not a version " << LEAPRECORDING_VERSION << " Leap recording";
+            m_file.close();
+            return false;
+        }
+
+        // frame offsets, a cut off frame ends the recording
+        size_t offset = sizeof(header);
+        while ( offset + sizeof(LeapRecordingFrame) <= m_file.size() )
+        {
+            LeapRecordingFrame frame = getFrameAt( offset );
+
+            size_t end = offset + sizeof(frame);
+            int    hands = 0;
+            for (; hands < frame.numHands && end + sizeof(LeapRecordingHand) <= m_file.size(); hands++)
+            {
+                LeapRecordingHand hand;
+                memcpy( &hand, m_file.data() + end, sizeof(hand) );
+                end += sizeof(hand) + (size_t)hand.numFingers * sizeof(LeapRecordingFinger);
+                if ( end > m_file.size() )
+                    break;
+            }
+            end += frame.numEvents * sizeof(LeapRecordingEvent);
+
+            if ( hands < frame.numHands || end > m_file.size() )
+            {
+                ofLogWarning("LeapReplay") << filename << " is truncated after " << m_frames.size() << " frames";
+                break;
+            }
+
+            m_frames.push_back( offset );
+            offset = end;
+        }
+
+        m_realTime = realTime;
+        m_loop     = loop;
+        rewind();
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    void rewind()
+    {
+        m_current  = -1;
+        m_next     = 0;
+        m_start    = ofGetElapsedTimeMicros();
+        iGestures  = LEAP_GESTURE_NONE;
+        m_events.clear();
+    }
+
+    // Steps to the frame of now, or the next one when not in real time
+    //--------------------------------------------------------------
+    virtual void updateGestures()
+    {
+        m_events.clear();
+
+        if ( m_next == m_frames.size() && m_loop && !m_frames.empty() )
+        {
+            m_next  = 0;
+            m_start = ofGetElapsedTimeMicros();
+        }
+
+        uint64_t now = ofGetElapsedTimeMicros();
+        while ( m_next < m_frames.size() )
+        {
+            LeapRecordingFrame frame = getFrame( m_next );
+            if ( m_realTime && frame.time > now - m_start )
+                break;
+
+            // gestures of every frame stepped over, none are lost
+            const char *data = getEvents( m_next );
+            for (int i = 0; i < frame.numEvents; i++)
+            {
+                LeapRecordingEvent recorded;
+                memcpy( &recorded, data + i * sizeof(recorded), sizeof(recorded) );
+
+                ofxLeapMotionGestureEvent event;
+                event.type        = recorded.type;
+                event.frameId     = recorded.frameId;
+                event.timestamp   = recorded.timestamp;
+                event.receiveTime = now;
+                event.position    = ofPoint( recorded.position[0], recorded.position[1], recorded.position[2] );
+                m_events.push_back( event );
+            }
+
+            iGestures = frame.gesture;
+            m_current = m_next++;
+
+            if ( !m_realTime )
+                break;
+        }
+    }
+
+    //--------------------------------------------------------------
+    virtual const vector <ofxLeapMotionGestureEvent> & getGestureEvents() const
+        { return m_events; }
+
+    //--------------------------------------------------------------
+    virtual void markFrameAsOld() {}
+
+    // Hands of the current frame, none before the first one
+    //--------------------------------------------------------------
+    virtual void getSimpleHands( ofxLeapMotionSimpleHands & simpleHands )
+    {
+        simpleHands.clear();
+        if ( m_current < 0 )
+            return;
+
+        LeapRecordingFrame frame = getFrame( m_current );
+        const char *data = m_file.data() + m_frames[m_current] + sizeof(frame);
+
+        for (int i = 0; i < frame.numHands; i++)
+        {
+            LeapRecordingHand hand;
+            memcpy( &hand, data, sizeof(hand) );
+            data += sizeof(hand);
+
+            if ( i >= LEAP_MAX_HANDS )
+            {
+                data += hand.numFingers * sizeof(LeapRecordingFinger);
+                continue;
+            }
+
+            ofxLeapMotionSimpleHand &out = simpleHands.items[ simpleHands.count++ ];
+            out.handPos    = ofPoint( hand.position[0], hand.position[1], hand.position[2] );
+            out.handNormal = ofPoint( hand.normal[0],   hand.normal[1],   hand.normal[2] );
+            out.fingers.clear();
+
+            for (uint32_t k = 0; k < hand.numFingers; k++)
+            {
+                LeapRecordingFinger finger;
+                memcpy( &finger, data, sizeof(finger) );
+                data += sizeof(finger);
+
+                ofxLeapMotionSimpleHand::simpleFinger f;
+                f.pos = ofPoint( finger.position[0], finger.position[1], finger.position[2] );
+                f.vel = ofPoint( finger.velocity[0], finger.velocity[1], finger.velocity[2] );
+                f.id  = finger.id;
+                out.fingers.push_back( f );
+            }
+        }
+    }
+
+    // Every frame played and no loop
+    //--------------------------------------------------------------
+    bool isFinished() const
+        { return !m_loop && m_next == m_frames.size(); }
+
+    //--------------------------------------------------------------
+    size_t getNumFrames() const
+        { return m_frames.size(); }
+
+    // Index of the frame played, -1 before the first
+    //--------------------------------------------------------------
+    int getCurrentFrame() const
+        { return m_current; }
+
+    //--------------------------------------------------------------
+    bool isLoaded() const
+        { return m_file.isOpen(); }
+
+private:
+
+    // Records are packed and sizeof(LeapRecordingHand) is no multiple of 8,
+    // so every record is copied out of the mapping instead of cast in place
+    //--------------------------------------------------------------
+    LeapRecordingFrame getFrameAt( size_t offset ) const
+    {
+        LeapRecordingFrame frame;
+        memcpy( &frame, m_file.data() + offset, sizeof(frame) );
+        return frame;
+    }
+
+    //--------------------------------------------------------------
+    LeapRecordingFrame getFrame( size_t i ) const
+        { return getFrameAt( m_frames[i] ); }
+
+    // Start of the event records of frame i
+    //--------------------------------------------------------------
+    const char* getEvents( size_t i ) const
+    {
+        LeapRecordingFrame frame = getFrame( i );
+        const char *data = m_file.data() + m_frames[i] + sizeof(frame);
+
+        for (int h = 0; h < frame.numHands; h++)
+        {
+            LeapRecordingHand hand;
+            memcpy( &hand, data, sizeof(hand) );
+            data += sizeof(hand) + hand.numFingers * sizeof(LeapRecordingFinger);
+        }
+
+        return data;
+    }
+
+    MappedFile                          m_file;
+    vector<size_t>                      m_frames;   // offset of every frame
+    vector<ofxLeapMotionGestureEvent>   m_events;
+
+    bool        m_realTime;
+    bool        m_loop;
+    int         m_current;
+    size_t      m_next;
+    uint64_t    m_start;
+};
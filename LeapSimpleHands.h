@@ -0,0 +1,170 @@
+//
+//  LeapSimpleHands.h
+//
+//  3/26/14.
+//
+//
+//  Simple hands and gesture events as plain fixed capacity values - no heap
+//  memory, copied with a memcpy, filled in place every frame by ofxLeapMotion.
+//  Kept apart from LeapWrapper.h so code without the Leap SDK can use them.
+
+#pragma once
+
+#include "ofMain.h"
+
+// hands and fingers past these are dropped
+#define LEAP_MAX_HANDS   4
+#define LEAP_MAX_FINGERS 5
+
+// Array of up to N values with the size() / [] / push_back of a vector
+template <class T, int N>
+struct LeapFixedArray
+{
+    T   items[N];
+    int count;
+    
+    LeapFixedArray()
+        : count( 0 ) {}
+    
+    //--------------------------------------------------------------
+    int size() const
+        { return count; }
+    
+    //--------------------------------------------------------------
+    bool empty() const
+        { return count == 0; }
+    
+    //--------------------------------------------------------------
+    void clear()
+        { count = 0; }
+    
+    // false when full, the value is dropped
+    //--------------------------------------------------------------
+    bool push_back( const T &value )
+    {
+        if ( count == N )
+            return false;
+        
+        items[count++] = value;
+        return true;
+    }
+    
+    //--------------------------------------------------------------
+    T& operator[]( int i )
+        { return items[i]; }
+    
+    //--------------------------------------------------------------
+    const T& operator[]( int i ) const
+        { return items[i]; }
+};
+
+class ofxLeapMotionSimpleHand
+{
+    
+    
+public:
+    
+    typedef struct simpleFinger
+    {
+        ofPoint pos;
+        ofPoint vel;
+        int64_t id;
+    }simpleFinger;
+    
+    LeapFixedArray <simpleFinger, LEAP_MAX_FINGERS> fingers;
+    
+    ofPoint handPos;
+    ofPoint handNormal;
+    
+    void debugDraw()
+    {
+        ofPushStyle();
+        
+        ofSetColor(190);
+        ofSetLineWidth(2);
+        
+        ofEnableLighting();
+        ofPushMatrix();
+        ofTranslate(handPos);
+        //rotate the hand by the downwards normal
+        ofQuaternion q;
+        q.makeRotate(ofPoint(0, -1, 0), handNormal);
+        ofMatrix4x4 m;
+        q.get(m);
+        glMultMatrixf(m.getPtr());
+        
+        
+        //scale it to make it not a box
+        ofScale(1, 0.35, 1.0);
+
+        ofDrawBox(0, 0, 0, 60);
+
+        ofPopMatrix();
+        
+        for(int i = 0; i < fingers.size(); i++)
+        {
+            ofDrawArrow(handPos, fingers[i].pos, 10);
+        }
+        
+        ofSetColor(220, 220, 0);
+    
+        for(int i = 0; i < fingers.size(); i++)
+        {
+            ofDrawArrow(fingers[i].pos + fingers[i].vel/20, fingers[i].pos + fingers[i].vel/10, 10);
+        }
+        
+        ofDisableLighting();
+        
+        ofPopStyle();
+    }
+};
+
+typedef LeapFixedArray <ofxLeapMotionSimpleHand, LEAP_MAX_HANDS> ofxLeapMotionSimpleHands;
+
+// Gesture codes, the values ofxLeapMotion::iGestures always had
+enum ofxLeapMotionGestureType
+{
+    LEAP_GESTURE_NONE           = 0,    // also sent when a gesture stops
+    LEAP_GESTURE_SCREEN_TAP     = 1,
+    LEAP_GESTURE_KEY_TAP        = 2,
+    LEAP_GESTURE_SWIPE_RIGHT    = 3,
+    LEAP_GESTURE_SWIPE_LEFT     = 4,
+    LEAP_GESTURE_SWIPE_DOWN     = 5,
+    LEAP_GESTURE_SWIPE_UP       = 6,
+    LEAP_GESTURE_SWIPE_FORWARD  = 7,
+    LEAP_GESTURE_SWIPE_BACK     = 8,
+    LEAP_GESTURE_CIRCLE_LEFT    = 9,    // counter-clockwise
+    LEAP_GESTURE_CIRCLE_RIGHT   = 10    // clockwise
+};
+
+// One gesture as the Leap thread classified it
+typedef struct ofxLeapMotionGestureEvent
+{
+    int      type;          // ofxLeapMotionGestureType
+    int64_t  frameId;
+    int64_t  timestamp;     // Leap clock, microseconds
+    uint64_t receiveTime;   // ofGetElapsedTimeMicros() on the Leap thread
+    ofPoint  position;      // mapped tap position or circle center, 0 otherwise
+} ofxLeapMotionGestureEvent;
+
+// What the app reads from the Leap every frame - the live device, or a
+// recording played back (LeapRecording.h)
+class ofxLeapMotionSource
+{
+public:
+    
+    // last gesture, ofxLeapMotionGestureType
+    int iGestures;
+    
+    ofxLeapMotionSource()
+        : iGestures( LEAP_GESTURE_NONE ) {}
+    
+    virtual ~ofxLeapMotionSource() {}
+    
+    // gestures since the last call, once per frame before anything else
+    virtual void updateGestures() = 0;
+    virtual const vector <ofxLeapMotionGestureEvent> & getGestureEvents() const = 0;
+    
+    virtual void markFrameAsOld() = 0;
+    virtual void getSimpleHands( ofxLeapMotionSimpleHands & simpleHands ) = 0;
+};
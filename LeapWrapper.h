@@ -8,80 +8,32 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "ofMain.h"
 #include "Leap.h"
-#include "Poco/Mutex.h"
+#include "TripleBuffer.h"
+#include "LockFreeQueue.h"
+#include "LeapSimpleHands.h"
 
 using namespace Leap;
 
-class ofxLeapMotionSimpleHand
-{
-    
-    
-public:
-    
-    typedef struct simpleFinger
-    {
-        ofPoint pos;
-        ofPoint vel;
-        int64_t id;
-    }simpleFinger;
-    
-    vector <simpleFinger>  fingers;
-    
-    ofPoint handPos;
-    ofPoint handNormal;
-    
-    void debugDraw()
-    {
-        ofPushStyle();
-        
-        ofSetColor(190);
-        ofSetLineWidth(2);
-        
-        ofEnableLighting();
-        ofPushMatrix();
-        ofTranslate(handPos);
-        //rotate the hand by the downwards normal
-        ofQuaternion q;
-        q.makeRotate(ofPoint(0, -1, 0), handNormal);
-        ofMatrix4x4 m;
-        q.get(m);
-        glMultMatrixf(m.getPtr());
-        
-        
-        //scale it to make it not a box
-        ofScale(1, 0.35, 1.0);
-
-        ofDrawBox(0, 0, 0, 60);
+// gesture events the Leap thread can queue before the main thread drains them
+#define GESTURE_QUEUE_SIZE 256
 
-        ofPopMatrix();
-        
-        for(int i = 0; i < fingers.size(); i++)
-        {
-            ofDrawArrow(handPos, fingers[i].pos, 10);
-        }
-        
-        ofSetColor(220, 220, 0);
-    
-        for(int i = 0; i < fingers.size(); i++)
-        {
-            ofDrawArrow(fingers[i].pos + fingers[i].vel/20, fingers[i].pos + fingers[i].vel/10, 10);
-        }
-        
-        ofDisableLighting();
-        
-        ofPopStyle();
-    }
-};
+// Hands of one Leap frame, handed from the Leap thread to the main thread
+typedef struct ofxLeapMotionHandSnapshot
+{
+    vector <Hand> hands;
+    int64_t frameId;
+    int64_t timestamp;      // Leap clock, microseconds
+    uint64_t publishTime;   // ofGetElapsedTimeMicros() when the Leap thread published it
+} ofxLeapMotionHandSnapshot;
 
-class ofxLeapMotion : public Listener
+class ofxLeapMotion : public Listener, public ofxLeapMotionSource
 {
 public:
     
-    // TODO: adding leap gesture support - JRW
-    int iGestures;
-	
     ofxLeapMotion()
     {
         reset();
@@ -93,6 +45,27 @@ public:
     {
         currentFrameID = 0;
         preFrameId = -1;
+        resetLatency();
+        
+        iGestures = LEAP_GESTURE_NONE;
+        gestureEvents.reserve( GESTURE_QUEUE_SIZE );
+        numGestureEvents   = 0;
+        numGesturesDropped = 0;
+        gestureLatencySum  = 0;
+    }
+    
+    // Counters of the hand handoff since the last reset
+    //--------------------------------------------------------------
+    void resetLatency()
+    {
+        numFramesPublished = 0;
+        numFramesConsumed  = 0;
+        numFramesSkipped   = 0;
+        lastConsumedId     = -1;
+        latencySum         = 0;
+        latencyMax         = 0;
+        sourceLatencySum   = 0;
+        clockOffset        = INT64_MAX;
     }
     
     ~ofxLeapMotion()
@@ -139,117 +112,46 @@ public:
         ourController->enableGesture(Gesture::TYPE_CIRCLE);
     }
     
-    // TODO: adding leap gesture support - JRW
+    // Gestures of the Leap thread in arrival order - main thread, once per
+    // frame. iGestures ends up where the last one left it, every gesture
+    // since the last call is in getGestureEvents().
     //--------------------------------------------------------------
-    void updateGestures()
+    virtual void updateGestures()
     {
+        uint64_t now = ofGetElapsedTimeMicros();
         
-        Leap::Frame frame = ourController->frame();
-        
-        if (lastFrame == frame)
-            return;
-        
-        Leap::GestureList gestures = lastFrame.isValid()    ?
-        frame.gestures(lastFrame) :
-        frame.gestures();
-        
-        lastFrame = frame;
-        
-        size_t numGestures = gestures.count();
-        
-        for (size_t i=0; i < numGestures; i++)
+        gestureEvents.clear();
+        ofxLeapMotionGestureEvent event;
+        while( gestureEvents.size() < gestureEvents.capacity() && gestureQueue.pop( event ) )
         {
+            gestureEvents.push_back( event );
+            gestureLatencySum += now - event.receiveTime;
+            numGestureEvents++;
             
-            // screen tap gesture (forward poke / tap)
-            if (gestures[i].type() == Leap::Gesture::TYPE_SCREEN_TAP)
-            {
-                Leap::ScreenTapGesture tap = gestures[i];
-                ofVec3f tapLoc = getMappedofPoint(tap.position());
-                
-                iGestures = 1;
-                
-            }
-            
-            // key tap gesture (down tap)
-            else if (gestures[i].type() == Leap::Gesture::TYPE_KEY_TAP)
-            {
-                Leap::KeyTapGesture tap = gestures[i];
-                
-                iGestures = 2;
-                
-            }
-            
-            // swipe gesture
-            else if (gestures[i].type() == Leap::Gesture::TYPE_SWIPE)
-            {
-                Leap::SwipeGesture swipe = gestures[i];
-                Leap::Vector diff = 0.04f*(swipe.position() - swipe.startPosition());
-                ofVec3f curSwipe(diff.x, -diff.y, diff.z);
-                
-                // swipe left
-                if (curSwipe.x < -3 && curSwipe.x > -20) {
-                    iGestures = 4;
-                }
-                // swipe right
-                else if (curSwipe.x > 3 && curSwipe.x < 20) {
-                    iGestures = 3;
-                }
-                // swipe up
-                if (curSwipe.y < -3 && curSwipe.y > -20) {
-                    iGestures = 6;
-                }
-                // swipe down
-                else if (curSwipe.y > 3 && curSwipe.y < 20) {
-                    iGestures = 5;
-                }
-                
-                // 3D swiping
-                // swipe forward
-                if (curSwipe.z < -5) {
-                    iGestures = 7;
-                }
-                // swipe back
-                else if (curSwipe.z > 5) {
-                    iGestures = 8;
-                }
-            }
-            
-            // circle gesture
-            else if (gestures[i].type() == Leap::Gesture::TYPE_CIRCLE)
-            {
-                Leap::CircleGesture circle = gestures[i];
-                float progress = circle.progress();
-                
-                if (progress >= 1.0f)
-                {
-                    
-                    ofVec3f center = getMappedofPoint(circle.center());
-                    ofVec3f normal(circle.normal().x, circle.normal().y, circle.normal().z);
-                    double curAngle = 6.5;
-                    if (normal.z < 0)
-                        curAngle *= -1;
-
-                    // clockwise rotation
-                    if (curAngle < 0)
-                        iGestures = 10;
-
-                    // counter-clockwise rotation
-                    else
-                        iGestures = 9;
-                }
-                
-            }
-            
-            // kill gesture when done
-            // gestures 5 & 6 are always in a STATE_STOP so we exclude
-            if (gestures[i].type() != 5 && gestures[i].type() != 6)
-            {
-                if (gestures[i].state() == Leap::Gesture::STATE_STOP)
-                    iGestures = 0;
-            }
+            iGestures = event.type;
         }
     }
     
+    //--------------------------------------------------------------
+    virtual const vector <ofxLeapMotionGestureEvent> & getGestureEvents() const
+        { return gestureEvents; }
+    
+    // Gesture events taken by updateGestures(), and the ones lost to a full
+    // queue - the main thread did not drain it for GESTURE_QUEUE_SIZE events
+    //--------------------------------------------------------------
+    size_t getNumGestureEvents() const
+        { return numGestureEvents; }
+    
+    //--------------------------------------------------------------
+    size_t getNumGesturesDropped() const
+        { return numGesturesDropped; }
+    
+    // Leap thread classification to updateGestures(), microseconds
+    //--------------------------------------------------------------
+    double getAverageGestureLatency() const
+        { return numGestureEvents ? (double)gestureLatencySum / numGestureEvents : 0; }
+    
+
     //--------------------------------------------------------------
     virtual void onInit(const Controller& controller)
     {
@@ -282,54 +184,97 @@ public:
     {
         ofLogVerbose("ofxLeapMotionApp - onFrame");
         
+        const Frame & frame = contr.frame();
         onFrameInternal(contr); // call this if you want to use getHands() / isFrameNew() etc
+        onFrameGestures(frame); // gesture events for updateGestures()
     }
     
-    //Simple access to the hands
+    //Simple access to the hands - the latest frame the Leap thread published,
+    //never blocks. The reference is valid until the next call, main thread only.
     //--------------------------------------------------------------
-    vector <Hand> getLeapHands()
+    const vector <Hand> & getLeapHands()
     {
-		
-        vector <Hand> handsCopy;
-        if( ourMutex.tryLock(2000) )
+        if( handBuffer.update() )
         {
-            handsCopy = hands;
-            ourMutex.unlock();
+            const ofxLeapMotionHandSnapshot & snapshot = handBuffer.getFront();
+            uint64_t now = ofGetElapsedTimeMicros();
+            
+            uint64_t latency = now - snapshot.publishTime;
+            latencySum += latency;
+            latencyMax  = std::max( latencyMax, latency );
+            
+            // the Leap clock is mapped to ours by the fastest delivery seen so far
+            clockOffset = std::min( clockOffset, (int64_t)snapshot.publishTime - snapshot.timestamp );
+            sourceLatencySum += now - ( snapshot.timestamp + clockOffset );
+            
+            if( lastConsumedId >= 0 && snapshot.frameId > lastConsumedId + 1 )
+                numFramesSkipped += snapshot.frameId - lastConsumedId - 1;
+            lastConsumedId = snapshot.frameId;
+            numFramesConsumed++;
         }
         
-        return handsCopy;
+        return handBuffer.getFront().hands;
     }
     
+    // Leap thread publish to getLeapHands(), microseconds
+    //--------------------------------------------------------------
+    double getAverageLatency() const
+        { return numFramesConsumed ? (double)latencySum / numFramesConsumed : 0; }
+    
+    //--------------------------------------------------------------
+    uint64_t getMaxLatency() const
+        { return latencyMax; }
+    
+    // Leap frame timestamp to getLeapHands(), microseconds - relative to
+    // the fastest delivery seen, which counts as zero
+    //--------------------------------------------------------------
+    double getAverageSourceLatency() const
+        { return numFramesConsumed ? (double)sourceLatencySum / numFramesConsumed : 0; }
+    
+    // Frames from the Leap thread, taken by the main thread, and the ones
+    // that were overwritten before the main thread got to them
+    //--------------------------------------------------------------
+    size_t getNumFramesPublished() const
+        { return numFramesPublished; }
+    
+    //--------------------------------------------------------------
+    size_t getNumFramesConsumed() const
+        { return numFramesConsumed; }
+    
+    //--------------------------------------------------------------
+    size_t getNumFramesSkipped() const
+        { return numFramesSkipped; }
+    
+    // Simple hands of the latest frame into a buffer the caller keeps,
+    // nothing is allocated. Hands and fingers past the capacity are dropped.
     //--------------------------------------------------------------
-    vector <ofxLeapMotionSimpleHand> getSimpleHands()
+    virtual void getSimpleHands( ofxLeapMotionSimpleHands & simpleHands )
     {
-		
-        vector <ofxLeapMotionSimpleHand> simpleHands;
-        vector <Hand> leapHands = getLeapHands();
+        const vector <Hand> & leapHands = getLeapHands();
         
-        for(int i = 0; i < leapHands.size(); i++)
+        simpleHands.clear();
+        for(int i = 0; i < leapHands.size() && i < LEAP_MAX_HANDS; i++)
         {
-            ofxLeapMotionSimpleHand curHand;
+            ofxLeapMotionSimpleHand & curHand = simpleHands.items[ simpleHands.count++ ];
             
             curHand.handPos     = getMappedofPoint( leapHands[i].palmPosition() );
             curHand.handNormal  = getofPoint( leapHands[i].palmNormal() );
             
-            for(int j = 0; j < leapHands[i].fingers().count(); j++)
+            // one finger list per hand, not one per finger
+            const FingerList fingers = leapHands[i].fingers();
+            int numFingers = std::min( fingers.count(), LEAP_MAX_FINGERS );
+            
+            curHand.fingers.clear();
+            for(int j = 0; j < numFingers; j++)
             {
-                const Finger & finger = leapHands[i].fingers()[j];
+                const Finger & finger = fingers[j];
                 
-                ofxLeapMotionSimpleHand::simpleFinger f;
+                ofxLeapMotionSimpleHand::simpleFinger & f = curHand.fingers.items[ curHand.fingers.count++ ];
                 f.pos = getMappedofPoint( finger.tipPosition() );
                 f.vel = getMappedofPoint( finger.tipVelocity() );
                 f.id = finger.id();
-                
-                curHand.fingers.push_back( f );
             }
-            
-            simpleHands.push_back( curHand );
         }
-        
-        return simpleHands;
     }
     
     //--------------------------------------------------------------
@@ -352,8 +297,8 @@ public:
         return currentFrameID != preFrameId;
     
     //--------------------------------------------------------------
-    void markFrameAsOld()
-        preFrameId = currentFrameID;
+    virtual void markFrameAsOld()
+        { preFrameId = currentFrameID; }
 
     //--------------------------------------------------------------
     int64_t getCurrentFrameID()
@@ -423,35 +368,178 @@ protected:
     //--------------------------------------------------------------
     virtual void onFrameInternal(const Controller& contr)
     {
-        ourMutex.lock();
+        // filled in place, the vector keeps its capacity from three frames ago
+        ofxLeapMotionHandSnapshot & snapshot = handBuffer.getBack();
         
         const Frame & curFrame	= contr.frame();
         const HandList & handList	= curFrame.hands();
         
-        hands.clear();
+        snapshot.hands.clear();
         for(int i = 0; i < handList.count(); i++)
-            hands.push_back( handList[i] );
-
+            snapshot.hands.push_back( handList[i] );
+        
+        snapshot.frameId     = curFrame.id();
+        snapshot.timestamp   = curFrame.timestamp();
+        snapshot.publishTime = ofGetElapsedTimeMicros();
+        handBuffer.publish();
         
         currentFrameID = curFrame.id();
+        numFramesPublished++;
+    }
+    
+    // Swipes, circles and taps of a frame to gesture events - Leap thread,
+    // nothing here waits on the main thread
+    //--------------------------------------------------------------
+    virtual void onFrameGestures(const Frame & frame)
+    {
+        if (lastFrame == frame)
+            return;
+        
+        Leap::GestureList gestures = lastFrame.isValid()    ?
+        frame.gestures(lastFrame) :
+        frame.gestures();
+        
+        lastFrame = frame;
+        
+        size_t numGestures = gestures.count();
+        
+        for (size_t i=0; i < numGestures; i++)
+        {
+            
+            // screen tap gesture (forward poke / tap)
+            if (gestures[i].type() == Leap::Gesture::TYPE_SCREEN_TAP)
+            {
+                Leap::ScreenTapGesture tap = gestures[i];
+                ofVec3f tapLoc = getMappedofPoint(tap.position());
+                
+                pushGesture( LEAP_GESTURE_SCREEN_TAP, frame, tapLoc );
+                
+            }
+            
+            // key tap gesture (down tap)
+            else if (gestures[i].type() == Leap::Gesture::TYPE_KEY_TAP)
+            {
+                Leap::KeyTapGesture tap = gestures[i];
+                
+                pushGesture( LEAP_GESTURE_KEY_TAP, frame );
+                
+            }
+            
+            // swipe gesture
+            else if (gestures[i].type() == Leap::Gesture::TYPE_SWIPE)
+            {
+                Leap::SwipeGesture swipe = gestures[i];
+                Leap::Vector diff = 0.04f*(swipe.position() - swipe.startPosition());
+                ofVec3f curSwipe(diff.x, -diff.y, diff.z);
+                
+                // swipe left
+                if (curSwipe.x < -3 && curSwipe.x > -20) {
+                    pushGesture( LEAP_GESTURE_SWIPE_LEFT, frame );
+                }
+                // swipe right
+                else if (curSwipe.x > 3 && curSwipe.x < 20) {
+                    pushGesture( LEAP_GESTURE_SWIPE_RIGHT, frame );
+                }
+                // swipe up
+                if (curSwipe.y < -3 && curSwipe.y > -20) {
+                    pushGesture( LEAP_GESTURE_SWIPE_UP, frame );
+                }
+                // swipe down
+                else if (curSwipe.y > 3 && curSwipe.y < 20) {
+                    pushGesture( LEAP_GESTURE_SWIPE_DOWN, frame );
+                }
+                
+                // 3D swiping
+                // swipe forward
+                if (curSwipe.z < -5) {
+                    pushGesture( LEAP_GESTURE_SWIPE_FORWARD, frame );
+                }
+                // swipe back
+                else if (curSwipe.z > 5) {
+                    pushGesture( LEAP_GESTURE_SWIPE_BACK, frame );
+                }
+            }
+            
+            // circle gesture
+            else if (gestures[i].type() == Leap::Gesture::TYPE_CIRCLE)
+            {
+                Leap::CircleGesture circle = gestures[i];
+                float progress = circle.progress();
+                
+                if (progress >= 1.0f)
+                {
+                    
+                    ofVec3f center = getMappedofPoint(circle.center());
+                    ofVec3f normal(circle.normal().x, circle.normal().y, circle.normal().z);
+                    double curAngle = 6.5;
+                    if (normal.z < 0)
+                        curAngle *= -1;
+
+                    // clockwise rotation
+                    if (curAngle < 0)
+                        pushGesture( LEAP_GESTURE_CIRCLE_RIGHT, frame, center );
+
+                    // counter-clockwise rotation
+                    else
+                        pushGesture( LEAP_GESTURE_CIRCLE_LEFT, frame, center );
+                }
+                
+            }
+            
+            // kill gesture when done
+            // gestures 5 & 6 are always in a STATE_STOP so we exclude
+            if (gestures[i].type() != 5 && gestures[i].type() != 6)
+            {
+                if (gestures[i].state() == Leap::Gesture::STATE_STOP)
+                    pushGesture( LEAP_GESTURE_NONE, frame );
+            }
+        }
+    }
+    
+    //--------------------------------------------------------------
+    void pushGesture(int type, const Frame & frame, const ofPoint & position = ofPoint())
+    {
+        ofxLeapMotionGestureEvent event;
+        event.type        = type;
+        event.position    = position;
+        event.frameId     = frame.id();
+        event.timestamp   = frame.timestamp();
+        event.receiveTime = ofGetElapsedTimeMicros();
         
-        ourMutex.unlock();
+        if( !gestureQueue.push( event ) )
+            numGesturesDropped++;
     }
     
-    int64_t currentFrameID;
+    std::atomic<int64_t> currentFrameID;
     int64_t preFrameId;
     
     float xOffsetIn, xOffsetOut, xScale;
     float yOffsetIn, yOffsetOut, yScale;
     float zOffsetIn, zOffsetOut, zScale;
     
-    vector <Hand> hands;
+    // Leap thread to main thread, lock free
+    TripleBuffer <ofxLeapMotionHandSnapshot> handBuffer;
     Leap::Controller * ourController;
     
     // TODO: added for Gesture support - JRW
-    Leap::Frame lastFrame;
-    
-    Poco::FastMutex ourMutex;
+    Leap::Frame lastFrame;  // Leap thread only
+    
+    // Leap thread to main thread, lock free
+    LockFreeQueue <ofxLeapMotionGestureEvent, GESTURE_QUEUE_SIZE> gestureQueue;
+    vector <ofxLeapMotionGestureEvent> gestureEvents;
+    size_t   numGestureEvents;
+    std::atomic<size_t> numGesturesDropped;
+    uint64_t gestureLatencySum;
+    
+    // handoff counters, numFramesPublished is written by the Leap thread
+    std::atomic<size_t> numFramesPublished;
+    size_t   numFramesConsumed;
+    size_t   numFramesSkipped;
+    int64_t  lastConsumedId;
+    uint64_t latencySum;
+    uint64_t latencyMax;
+    uint64_t sourceLatencySum;
+    int64_t  clockOffset;
 };
 
 
@@ -0,0 +1,69 @@
+//
+//  LockFreeQueue.h
+//
+//  3/26/14.
+//
+//
+//  Bounded single producer / single consumer queue. Push and pop never
+//  wait or allocate, a push into a full queue fails and the caller
+//  decides what to do with the value. N has to be a power of two.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+template <class T, int N>
+class LockFreeQueue
+{
+public:
+
+    LockFreeQueue()
+    {
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    // Producer - false when full
+    //--------------------------------------------------------------
+    bool push( const T &value )
+    {
+        size_t tail = m_tail.load( std::memory_order_relaxed );
+        if ( tail - m_head.load( std::memory_order_acquire ) == N )
+            return false;
+
+        m_items[ tail & ( N - 1 ) ] = value;
+        m_tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer - false when empty
+    //--------------------------------------------------------------
+    bool pop( T &value )
+    {
+        size_t head = m_head.load( std::memory_order_relaxed );
+        if ( head == m_tail.load( std::memory_order_acquire ) )
+            return false;
+
+        value = m_items[ head & ( N - 1 ) ];
+        m_head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Either side, a snapshot that may be stale by the time it returns
+    //--------------------------------------------------------------
+    size_t size() const
+    {
+        return m_tail.load( std::memory_order_acquire ) - m_head.load( std::memory_order_acquire );
+    }
+
+private:
+
+    static_assert( ( N & ( N - 1 ) ) == 0, "LockFreeQueue capacity has to be a power of two" );
+
+    T                       m_items[N];
+
+    // apart, so the two threads do not share a cache line
+    alignas(64) std::atomic<size_t> m_head;     // consumer
+    alignas(64) std::atomic<size_t> m_tail;     // producer
+};
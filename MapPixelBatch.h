@@ -0,0 +1,214 @@
+//
+//  MapPixelBatch.h
+//
+//  3/26/14.
+//
+//
+//  Batched renderer for the map pixels (circles).
+//  The visible set is collected per frame as one 20 byte record per pixel -
+//  position, height, radius and 8-bit RGBA - instead of an ofSetColor /
+//  ofCircle pair per point. draw() uploads the records as an instance
+//  buffer and a vertex shader places one shared unit circle at each of
+//  them, in a single instanced call.
+//  Filling the records is CPU only and runs without a GL context.
+
+#pragma once
+
+#include "ofMain.h"
+
+// same as the default ofCircle resolution
+#define MAPPIXEL_SEGMENTS 20
+
+// One map pixel - a filled circle parallel to the map plane, also the
+// instance record: x, y, z, radius read as one vec4, color as normalized bytes
+typedef struct MapPixel
+{
+    float   x;
+    float   y;
+    float   z;
+    float   radius;
+    ofColor color;
+} MapPixel;
+
+static_assert( sizeof(MapPixel) == 4 * sizeof(float) + 4, "the shader reads MapPixel as packed floats and bytes" );
+
+
+class MapPixelBatch
+{
+public:
+
+    MapPixelBatch()
+    {
+        m_ready     = false;
+        m_instanced = false;
+        m_circle    = 0;
+        m_records   = 0;
+    }
+
+    ~MapPixelBatch()
+    {
+        if ( m_circle )
+            glDeleteBuffers( 1, &m_circle );
+        if ( m_records )
+            glDeleteBuffers( 1, &m_records );
+    }
+
+    //--------------------------------------------------------------
+    void clear()
+    {
+        m_pixels.clear();
+    }
+
+    //--------------------------------------------------------------
+    void add( float x, float y, float z, float radius, const ofColor &color, float alpha )
+    {
+        MapPixel pixel = { x, y, z, radius, ofColor( color, alpha ) };
+        m_pixels.push_back( pixel );
+    }
+
+    // Room for count pixels, to be set by index - a thread can set a range
+    //--------------------------------------------------------------
+    void resize( size_t count )
+    {
+        m_pixels.resize( count );
+    }
+
+    //--------------------------------------------------------------
+    void set( size_t i, float x, float y, float z, float radius, const ofColor &color, float alpha )
+    {
+        MapPixel pixel = { x, y, z, radius, ofColor( color, alpha ) };
+        m_pixels[i] = pixel;
+    }
+
+    // Uploads the records and draws every pixel in one instanced call.
+    // Without instanced arrays it falls back to a circle per pixel.
+    //--------------------------------------------------------------
+    void draw()
+    {
+        if ( m_pixels.empty() )
+            return;
+
+        if ( !m_ready )
+            setup();
+
+        if ( !m_instanced )
+        {
+            for (size_t i = 0; i < m_pixels.size(); i++)
+            {
+                const MapPixel &pixel = m_pixels[i];
+                ofSetColor( pixel.color );
+                ofCircle( pixel.x, pixel.y, pixel.z, pixel.radius );
+            }
+            return;
+        }
+
+        glBindBuffer( GL_ARRAY_BUFFER, m_records );
+        glBufferData( GL_ARRAY_BUFFER, getNumBytes(), m_pixels.data(), GL_STREAM_DRAW );
+
+        m_shader.begin();
+
+        glBindBuffer( GL_ARRAY_BUFFER, m_circle );
+        glEnableVertexAttribArray( m_unitAttribute );
+        glVertexAttribPointer( m_unitAttribute, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+
+        glBindBuffer( GL_ARRAY_BUFFER, m_records );
+        glEnableVertexAttribArray( m_pixelAttribute );
+        glVertexAttribPointer( m_pixelAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(MapPixel),
+                               (const GLvoid*)offsetof( MapPixel, x ) );
+        glVertexAttribDivisorARB( m_pixelAttribute, 1 );
+        glEnableVertexAttribArray( m_colorAttribute );
+        glVertexAttribPointer( m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MapPixel),
+                               (const GLvoid*)offsetof( MapPixel, color ) );
+        glVertexAttribDivisorARB( m_colorAttribute, 1 );
+
+        glDrawArraysInstancedARB( GL_TRIANGLE_FAN, 0, MAPPIXEL_SEGMENTS + 2, m_pixels.size() );
+
+        glVertexAttribDivisorARB( m_pixelAttribute, 0 );
+        glVertexAttribDivisorARB( m_colorAttribute, 0 );
+        glDisableVertexAttribArray( m_unitAttribute );
+        glDisableVertexAttribArray( m_pixelAttribute );
+        glDisableVertexAttribArray( m_colorAttribute );
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        m_shader.end();
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_pixels.size(); }
+
+    // Bytes draw() uploads
+    //--------------------------------------------------------------
+    size_t getNumBytes() const
+        { return m_pixels.size() * sizeof(MapPixel); }
+
+private:
+
+    // owns GL buffers, the frames keep theirs in place
+    MapPixelBatch( const MapPixelBatch& ) = delete;
+    MapPixelBatch& operator=( const MapPixelBatch& ) = delete;
+
+    // Unit circle and shader on the first draw, with the GL context current
+    //--------------------------------------------------------------
+    void setup()
+    {
+        m_ready = true;
+
+        if ( !glewIsSupported( "GL_ARB_instanced_arrays GL_ARB_draw_instanced" ) )
+        {
+            ofLogWarning("MapPixelBatch") << "no instanced arrays, drawing a circle per pixel";
+            return;
+        }
+
+        // GLSL 1.20 for the app's fixed function renderer
+        m_shader.setupShaderFromSource( GL_VERTEX_SHADER,
+            "#version 120\n"
+            "attribute vec2 unit;\n"
+            "attribute vec4 pixel;\n"      // x, y, z, radius
+            "attribute vec4 color;\n"
+            "void main() {\n"
+            "    gl_FrontColor = color;\n"
+            "    gl_Position   = gl_ModelViewProjectionMatrix * vec4( pixel.xy + unit * pixel.w, pixel.z, 1.0 );\n"
+            "}\n" );
+        m_shader.setupShaderFromSource( GL_FRAGMENT_SHADER,
+            "#version 120\n"
+            "void main() { gl_FragColor = gl_Color; }\n" );
+
+        if ( !m_shader.linkProgram() )
+        {
+            ofLogWarning("MapPixelBatch") << "map pixel shader did not link, drawing a circle per pixel";
+            return;
+        }
+
+        m_unitAttribute  = m_shader.getAttributeLocation( "unit" );
+        m_pixelAttribute = m_shader.getAttributeLocation( "pixel" );
+        m_colorAttribute = m_shader.getAttributeLocation( "color" );
+
+        // a fan around the center, the first rim point closes it
+        vector<ofVec2f> circle( 1, ofVec2f( 0, 0 ) );
+        for (int i = 0; i <= MAPPIXEL_SEGMENTS; i++)
+        {
+            float angle = TWO_PI * i / MAPPIXEL_SEGMENTS;
+            circle.push_back( ofVec2f( cos(angle), sin(angle) ) );
+        }
+
+        glGenBuffers( 1, &m_circle );
+        glBindBuffer( GL_ARRAY_BUFFER, m_circle );
+        glBufferData( GL_ARRAY_BUFFER, circle.size() * sizeof(ofVec2f), circle.data(), GL_STATIC_DRAW );
+        glGenBuffers( 1, &m_records );
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        m_instanced = true;
+    }
+
+    vector<MapPixel>        m_pixels;
+
+    bool                    m_ready;        // setup() ran
+    bool                    m_instanced;
+    ofShader                m_shader;
+    GLuint                  m_circle;       // unit circle fan, static
+    GLuint                  m_records;      // the pixels, streamed every frame
+    GLint                   m_unitAttribute;
+    GLint                   m_pixelAttribute;
+    GLint                   m_colorAttribute;
+};
@@ -0,0 +1,92 @@
+//
+//  MapPixelCurves.h
+//
+//  3/26/14.
+//
+//
+//  The easing curves that shape the map pixels, specialized for their fixed
+//  ranges. Replaces six ofxTween::map calls per pixel (easeQuad, easeInOut).
+//  The three curves over the fade range share one eased value.
+//  MapPixelKernel.h runs them over the whole visible set.
+
+#pragma once
+
+#include "ofMain.h"
+
+// Inputs and outputs of the curves, one entry per visible pixel
+typedef struct MapPixelAttributes
+{
+    vector<float> x;            // projected position
+    vector<float> y;
+    vector<float> elevation;    // raw elevation
+
+    vector<float> alpha;        // circle alpha
+    vector<float> radius;       // circle radius, shrunk by elevation
+    vector<float> z;            // circle height plus elevation
+    vector<float> labelAlpha;   // street label alpha
+
+    void resize( size_t count )
+    {
+        x.resize( count );
+        y.resize( count );
+        elevation.resize( count );
+        alpha.resize( count );
+        radius.resize( count );
+        z.resize( count );
+        labelAlpha.resize( count );
+    }
+} MapPixelAttributes;
+
+
+namespace MapPixelCurves {
+
+    // input ranges
+    const float FADE_NEAR     = 40;
+    const float FADE_FAR      = 280;
+    const float LABEL_NEAR    = 70;
+    const float ELEVATION_MAX = 280;
+
+    // Quadratic ease in/out on 0..1
+    //--------------------------------------------------------------
+    inline float easeQuadInOut( float u )
+    {
+        if ( u < 0.5f )
+            return 2 * u * u;
+
+        float v = 1 - u;
+        return 1 - 2 * v * v;
+    }
+
+    // Clamped 0..1 position of value in [inMin, inMax], eased
+    //--------------------------------------------------------------
+    inline float ease( float value, float inMin, float inMax )
+    {
+        float u = ( value - inMin ) / ( inMax - inMin );
+        u = u < 0 ? 0 : ( u > 1 ? 1 : u );
+
+        return easeQuadInOut( u );
+    }
+
+    // Same as ofxTween::map( elevation, 0, 280, -15, 50, true, easeQuad, easeInOut )
+    //--------------------------------------------------------------
+    inline float elevationHeight( float elevation )
+    {
+        return -15 + 65 * ease( elevation, 0, ELEVATION_MAX );
+    }
+
+    // All curves of one pixel from its screen distance and elevation
+    //--------------------------------------------------------------
+    inline void evaluate( float dist, float elevation,
+                          float &alpha, float &radius, float &z, float &labelAlpha )
+    {
+        float fade  = ease( dist, FADE_NEAR,  FADE_FAR );
+        float label = ease( dist, LABEL_NEAR, FADE_FAR );
+        float high  = ease( elevation, 0, ELEVATION_MAX );
+
+        alpha      = 180 - 180 * fade;
+        radius     = ( 4.5f - 4 * fade ) + ( -1.5f * high );
+        z          = ( 15 - 15 * fade ) + ( -15 + 65 * high );
+        labelAlpha = 255 - 255 * label;
+    }
+
+} // End of MapPixelCurves
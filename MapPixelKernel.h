@@ -0,0 +1,215 @@
+//
+//  MapPixelKernel.h
+//
+//  3/26/14.
+//
+//
+//  Per-frame attribute stage for the visible map pixels.
+//  Takes the projected x / y and elevation arrays and writes alpha, radius,
+//  z and label alpha for the whole visible set, ahead of any GL call.
+//  SSE2 and AVX2 versions on x86 (AVX2 picked at runtime), scalar elsewhere.
+//  SSE2 only when the compiler targets it, e.g. not with -mno-sse2.
+
+#pragma once
+
+#include "ofMain.h"
+#include "MapPixelCurves.h"
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define MAPPIXEL_X86
+#include <immintrin.h>
+#define MAPPIXEL_AVX2 __attribute__((target("avx2")))
+#ifdef __SSE2__
+#define MAPPIXEL_SSE2
+#endif
+#endif
+
+namespace MapPixelKernel {
+
+    enum Isa
+    {
+        ISA_SCALAR,
+        ISA_SSE2,
+        ISA_AVX2
+    };
+
+    //--------------------------------------------------------------
+    inline const char* getIsaName( Isa isa )
+    {
+        switch ( isa )
+        {
+            case ISA_SSE2: return "SSE2";
+            case ISA_AVX2: return "AVX2";
+            default:       return "scalar";
+        }
+    }
+
+    //--------------------------------------------------------------
+    inline bool isSupported( Isa isa )
+    {
+#ifdef MAPPIXEL_SSE2
+        if ( isa == ISA_SSE2 )
+            return __builtin_cpu_supports( "sse2" );
+#endif
+#ifdef MAPPIXEL_X86
+        if ( isa == ISA_AVX2 )
+            return __builtin_cpu_supports( "avx2" );
+#endif
+        return isa == ISA_SCALAR;
+    }
+
+    //--------------------------------------------------------------
+    inline Isa getBestIsa()
+    {
+        static Isa best = isSupported( ISA_AVX2 ) ? ISA_AVX2 :
+                          isSupported( ISA_SSE2 ) ? ISA_SSE2 : ISA_SCALAR;
+        return best;
+    }
+
+    // Pixels [begin, end) one at a time, also the tail of the vector versions
+    //--------------------------------------------------------------
+    inline void computeScalar( MapPixelAttributes &pixels, float centerX, float centerY,
+                               size_t begin, size_t end )
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            float dx = pixels.x[i] - centerX;
+            float dy = pixels.y[i] - centerY;
+
+            MapPixelCurves::evaluate( sqrtf( dx * dx + dy * dy ), pixels.elevation[i],
+                                      pixels.alpha[i], pixels.radius[i],
+                                      pixels.z[i], pixels.labelAlpha[i] );
+        }
+    }
+
+#ifdef MAPPIXEL_SSE2
+
+    //--------------------------------------------------------------
+    inline __m128 easeSSE2( __m128 value, float inMin, float inMax )
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one  = _mm_set1_ps( 1 );
+        const __m128 two  = _mm_set1_ps( 2 );
+
+        __m128 u = _mm_div_ps( _mm_sub_ps( value, _mm_set1_ps( inMin ) ), _mm_set1_ps( inMax - inMin ) );
+        u = _mm_min_ps( _mm_max_ps( u, zero ), one );
+
+        __m128 v    = _mm_sub_ps( one, u );
+        __m128 in   = _mm_mul_ps( two, _mm_mul_ps( u, u ) );
+        __m128 out  = _mm_sub_ps( one, _mm_mul_ps( two, _mm_mul_ps( v, v ) ) );
+        __m128 mask = _mm_cmplt_ps( u, _mm_set1_ps( 0.5f ) );
+
+        return _mm_or_ps( _mm_and_ps( mask, in ), _mm_andnot_ps( mask, out ) );
+    }
+
+    //--------------------------------------------------------------
+    inline void computeSSE2( MapPixelAttributes &pixels, float centerX, float centerY,
+                             size_t begin, size_t end )
+    {
+        size_t i = begin;
+
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 dx   = _mm_sub_ps( _mm_loadu_ps( &pixels.x[i] ), _mm_set1_ps( centerX ) );
+            __m128 dy   = _mm_sub_ps( _mm_loadu_ps( &pixels.y[i] ), _mm_set1_ps( centerY ) );
+            __m128 dist = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) );
+
+            __m128 fade  = easeSSE2( dist, MapPixelCurves::FADE_NEAR,  MapPixelCurves::FADE_FAR );
+            __m128 label = easeSSE2( dist, MapPixelCurves::LABEL_NEAR, MapPixelCurves::FADE_FAR );
+            __m128 high  = easeSSE2( _mm_loadu_ps( &pixels.elevation[i] ), 0, MapPixelCurves::ELEVATION_MAX );
+
+            _mm_storeu_ps( &pixels.alpha[i],
+                           _mm_sub_ps( _mm_set1_ps( 180 ), _mm_mul_ps( _mm_set1_ps( 180 ), fade ) ) );
+            _mm_storeu_ps( &pixels.radius[i],
+                           _mm_add_ps( _mm_sub_ps( _mm_set1_ps( 4.5f ), _mm_mul_ps( _mm_set1_ps( 4 ), fade ) ),
+                                       _mm_mul_ps( _mm_set1_ps( -1.5f ), high ) ) );
+            _mm_storeu_ps( &pixels.z[i],
+                           _mm_add_ps( _mm_sub_ps( _mm_set1_ps( 15 ), _mm_mul_ps( _mm_set1_ps( 15 ), fade ) ),
+                                       _mm_add_ps( _mm_set1_ps( -15 ), _mm_mul_ps( _mm_set1_ps( 65 ), high ) ) ) );
+            _mm_storeu_ps( &pixels.labelAlpha[i],
+                           _mm_sub_ps( _mm_set1_ps( 255 ), _mm_mul_ps( _mm_set1_ps( 255 ), label ) ) );
+        }
+
+        computeScalar( pixels, centerX, centerY, i, end );
+    }
+
+#endif
+
+#ifdef MAPPIXEL_X86
+
+    //--------------------------------------------------------------
+    MAPPIXEL_AVX2 inline __m256 easeAVX2( __m256 value, float inMin, float inMax )
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one  = _mm256_set1_ps( 1 );
+        const __m256 two  = _mm256_set1_ps( 2 );
+
+        __m256 u = _mm256_div_ps( _mm256_sub_ps( value, _mm256_set1_ps( inMin ) ), _mm256_set1_ps( inMax - inMin ) );
+        u = _mm256_min_ps( _mm256_max_ps( u, zero ), one );
+
+        __m256 v    = _mm256_sub_ps( one, u );
+        __m256 in   = _mm256_mul_ps( two, _mm256_mul_ps( u, u ) );
+        __m256 out  = _mm256_sub_ps( one, _mm256_mul_ps( two, _mm256_mul_ps( v, v ) ) );
+        __m256 mask = _mm256_cmp_ps( u, _mm256_set1_ps( 0.5f ), _CMP_LT_OQ );
+
+        return _mm256_blendv_ps( out, in, mask );
+    }
+
+    //--------------------------------------------------------------
+    MAPPIXEL_AVX2 inline void computeAVX2( MapPixelAttributes &pixels, float centerX, float centerY,
+                                           size_t begin, size_t end )
+    {
+        size_t i = begin;
+
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 dx   = _mm256_sub_ps( _mm256_loadu_ps( &pixels.x[i] ), _mm256_set1_ps( centerX ) );
+            __m256 dy   = _mm256_sub_ps( _mm256_loadu_ps( &pixels.y[i] ), _mm256_set1_ps( centerY ) );
+            __m256 dist = _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ) );
+
+            __m256 fade  = easeAVX2( dist, MapPixelCurves::FADE_NEAR,  MapPixelCurves::FADE_FAR );
+            __m256 label = easeAVX2( dist, MapPixelCurves::LABEL_NEAR, MapPixelCurves::FADE_FAR );
+            __m256 high  = easeAVX2( _mm256_loadu_ps( &pixels.elevation[i] ), 0, MapPixelCurves::ELEVATION_MAX );
+
+            _mm256_storeu_ps( &pixels.alpha[i],
+                              _mm256_sub_ps( _mm256_set1_ps( 180 ), _mm256_mul_ps( _mm256_set1_ps( 180 ), fade ) ) );
+            _mm256_storeu_ps( &pixels.radius[i],
+                              _mm256_add_ps( _mm256_sub_ps( _mm256_set1_ps( 4.5f ), _mm256_mul_ps( _mm256_set1_ps( 4 ), fade ) ),
+                                             _mm256_mul_ps( _mm256_set1_ps( -1.5f ), high ) ) );
+            _mm256_storeu_ps( &pixels.z[i],
+                              _mm256_add_ps( _mm256_sub_ps( _mm256_set1_ps( 15 ), _mm256_mul_ps( _mm256_set1_ps( 15 ), fade ) ),
+                                             _mm256_add_ps( _mm256_set1_ps( -15 ), _mm256_mul_ps( _mm256_set1_ps( 65 ), high ) ) ) );
+            _mm256_storeu_ps( &pixels.labelAlpha[i],
+                              _mm256_sub_ps( _mm256_set1_ps( 255 ), _mm256_mul_ps( _mm256_set1_ps( 255 ), label ) ) );
+        }
+
+        computeScalar( pixels, centerX, centerY, i, end );
+    }
+
+#endif
+
+    // Attributes of pixels [begin, end), relative to the projected map center.
+    // Ranges that do not overlap can run on different threads.
+    //--------------------------------------------------------------
+    inline void compute( MapPixelAttributes &pixels, float centerX, float centerY,
+                         size_t begin, size_t end, Isa isa = getBestIsa() )
+    {
+#ifdef MAPPIXEL_X86
+        if ( isa == ISA_AVX2 )
+            return computeAVX2( pixels, centerX, centerY, begin, end );
+#endif
+#ifdef MAPPIXEL_SSE2
+        if ( isa == ISA_SSE2 )
+            return computeSSE2( pixels, centerX, centerY, begin, end );
+#endif
+        computeScalar( pixels, centerX, centerY, begin, end );
+    }
+
+    // Attributes of every pixel
+    //--------------------------------------------------------------
+    inline void compute( MapPixelAttributes &pixels, float centerX, float centerY, Isa isa = getBestIsa() )
+    {
+        compute( pixels, centerX, centerY, 0, pixels.x.size(), isa );
+    }
+
+} // End of MapPixelKernel
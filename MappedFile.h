@@ -0,0 +1,111 @@
+//
+//  MappedFile.h
+//
+//  3/26/14.
+//
+//
+//  Read-only memory mapping of a data file.
+//  Windows falls back to reading the file into a buffer.
+
+#pragma once
+
+#include "ofMain.h"
+
+#ifndef TARGET_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+class MappedFile
+{
+public:
+
+    MappedFile()
+    {
+        m_data = NULL;
+        m_size = 0;
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // path goes through ofToDataPath
+    //--------------------------------------------------------------
+    bool open( string path )
+    {
+        close();
+        path = ofToDataPath( path );
+
+#ifndef TARGET_WIN32
+        int fd = ::open( path.c_str(), O_RDONLY );
+        if ( fd < 0 )
+            return false;
+
+        struct stat info;
+        if ( fstat( fd, &info ) != 0 || info.st_size == 0 )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        void *data = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+
+        if ( data == MAP_FAILED )
+            return false;
+
+        m_data = (const char*)data;
+        m_size = info.st_size;
+#else
+        m_buffer = ofBufferFromFile( path, true );
+        if ( m_buffer.size() == 0 )
+            return false;
+
+        m_data = m_buffer.getBinaryBuffer();
+        m_size = m_buffer.size();
+#endif
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    void close()
+    {
+#ifndef TARGET_WIN32
+        if ( m_data )
+            munmap( (void*)m_data, m_size );
+#else
+        m_buffer.clear();
+#endif
+        m_data = NULL;
+        m_size = 0;
+    }
+
+    //--------------------------------------------------------------
+    const char* data() const
+        { return m_data; }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_size; }
+
+    //--------------------------------------------------------------
+    bool isOpen() const
+        { return m_data != NULL; }
+
+private:
+
+    // not copyable, the mapping is owned
+    MappedFile( const MappedFile& );
+    MappedFile& operator=( const MappedFile& );
+
+    const char *m_data;
+    size_t      m_size;
+
+#ifdef TARGET_WIN32
+    ofBuffer    m_buffer;
+#endif
+};
@@ -0,0 +1,122 @@
+//
+//  MercatorProjector.h
+//
+//  3/26/14.
+//
+//
+//  Batch Web Mercator projection for a fixed zoom.
+//  On screen, x is linear in longitude and y is linear in the Mercator
+//  transformed latitude, so once the map is set up for a frame the
+//  projection is two multiply-adds per point. The constants are fitted
+//  from the map's own geoLocationToPoint, once per frame.
+
+#pragma once
+
+#include "ofMain.h"
+
+class MercatorProjector
+{
+public:
+
+    MercatorProjector()
+    {
+        m_lat0 = m_lon0 = 0;
+        m_merc0 = 0;
+        m_x0 = m_y0 = 0;
+        m_scaleX = m_scaleY = 1;
+    }
+
+    // Mercator y of a latitude in degrees, stored per point at load time
+    //--------------------------------------------------------------
+    static double toMercatorY( double lat )
+    {
+        return log( tan( PI / 4 + lat * DEG_TO_RAD / 2 ) );
+    }
+
+    //--------------------------------------------------------------
+    static double fromMercatorY( double mercY )
+    {
+        return atan( sinh( mercY ) ) * RAD_TO_DEG;
+    }
+
+    // Fits the projection to the screen points of the center location
+    // and of the locations one step north and one step east of it
+    //--------------------------------------------------------------
+    void calibrate( double lat, double lon, double step,
+                    const ofPoint &center, const ofPoint &north, const ofPoint &east )
+    {
+        m_lat0   = lat;
+        m_lon0   = lon;
+        m_merc0  = toMercatorY( lat );
+        m_x0     = center.x;
+        m_y0     = center.y;
+        m_scaleX = ( east.x  - center.x ) / step;
+        m_scaleY = ( north.y - center.y ) / ( toMercatorY( lat + step ) - m_merc0 );
+    }
+
+    //--------------------------------------------------------------
+    ofPoint project( double lat, double lon ) const
+    {
+        return ofPoint( m_x0 + m_scaleX * ( lon - m_lon0 ),
+                        m_y0 + m_scaleY * ( toMercatorY( lat ) - m_merc0 ) );
+    }
+
+    // Projects the points listed in ids from their stored longitude and Mercator y
+    //--------------------------------------------------------------
+    void project( const float *longitude, const float *mercatorY, const int *ids, size_t count,
+                  float *x, float *y ) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            x[i] = m_x0 + m_scaleX * ( longitude[ ids[i] ] - m_lon0 );
+            y[i] = m_y0 + m_scaleY * ( mercatorY[ ids[i] ] - m_merc0 );
+        }
+    }
+
+    // Screen point back to a location - ofPoint( lat, lon ), like Map::pointToGeolocation
+    //--------------------------------------------------------------
+    ofPoint unproject( double x, double y ) const
+    {
+        return ofPoint( fromMercatorY( m_merc0 + ( y - m_y0 ) / m_scaleY ),
+                        m_lon0 + ( x - m_x0 ) / m_scaleX );
+    }
+
+    // Same for count screen points
+    //--------------------------------------------------------------
+    void unproject( const float *x, const float *y, size_t count, float *lat, float *lon ) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            lat[i] = fromMercatorY( m_merc0 + ( y[i] - m_y0 ) / m_scaleY );
+            lon[i] = m_lon0 + ( x[i] - m_x0 ) / m_scaleX;
+        }
+    }
+
+    // Screen offset of every projected point since the previous projection.
+    // Only a translation while the scale is the same, false otherwise.
+    //--------------------------------------------------------------
+    bool getTranslation( const MercatorProjector &previous, float &dx, float &dy ) const
+    {
+        if ( fabs( m_scaleX - previous.m_scaleX ) > fabs( m_scaleX ) * 1e-5 ||
+             fabs( m_scaleY - previous.m_scaleY ) > fabs( m_scaleY ) * 1e-5 )
+            return false;
+
+        dx = ( m_x0 - previous.m_x0 ) - m_scaleX * ( m_lon0  - previous.m_lon0 );
+        dy = ( m_y0 - previous.m_y0 ) - m_scaleY * ( m_merc0 - previous.m_merc0 );
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    ofPoint getCenter() const
+        { return ofPoint( m_x0, m_y0 ); }
+
+private:
+
+    double m_lat0;
+    double m_lon0;
+    double m_merc0;
+    double m_x0;
+    double m_y0;
+    double m_scaleX;    // pixels per degree of longitude
+    double m_scaleY;    // pixels per unit of Mercator y
+};
@@ -0,0 +1,166 @@
+//
+//  ScreenGrid.h
+//
+//  3/26/14.
+//
+//
+//  Bucket grid over the projected positions of the visible set.
+//  Rebuilt every frame in update(), a finger radius query only looks at
+//  the few cells around the finger instead of every visible point.
+//  Counts the points each query tests, for the benchmarks.
+
+#pragma once
+
+#include "ofMain.h"
+
+class ScreenGrid
+{
+public:
+
+    ScreenGrid()
+    {
+        m_minX = m_minY = 0;
+        m_cellSize = 16;
+        m_rows = m_cols = 0;
+        m_numQueries = m_numTested = 0;
+    }
+
+    // x / y are indexed like the visible set, cellSize is in pixels and
+    // doubled like in GeoGrid if the points are spread far off screen
+    //--------------------------------------------------------------
+    void build( const float *x, const float *y, size_t count, float cellSize = 16 )
+    {
+        m_rows = m_cols = 0;
+        m_cellStart.clear();
+        m_indices.clear();
+        m_x.clear();
+        m_y.clear();
+        m_numQueries = m_numTested = 0;
+
+        if ( count == 0 )
+            return;
+
+        float minX = x[0], maxX = minX;
+        float minY = y[0], maxY = minY;
+
+        for (size_t i = 1; i < count; i++)
+        {
+            minX = std::min( minX, x[i] );
+            maxX = std::max( maxX, x[i] );
+            minY = std::min( minY, y[i] );
+            maxY = std::max( maxY, y[i] );
+        }
+
+        double maxCells = std::max( (double)count * 2, 1024.0 );
+        while ( ( (maxX - minX) / cellSize + 1 ) * ( (maxY - minY) / cellSize + 1 ) > maxCells )
+            cellSize *= 2;
+
+        m_minX     = minX;
+        m_minY     = minY;
+        m_cellSize = cellSize;
+        m_rows = int( (maxY - minY) / cellSize ) + 1;
+        m_cols = int( (maxX - minX) / cellSize ) + 1;
+
+        // counting sort of the indices by cell, same layout as GeoGrid
+        vector<int> cellOf( count );
+        m_cellStart.assign( (size_t)m_rows * m_cols + 1, 0 );
+
+        for (size_t i = 0; i < count; i++)
+        {
+            cellOf[i] = rowOf( y[i] ) * m_cols + colOf( x[i] );
+            m_cellStart[ cellOf[i] + 1 ]++;
+        }
+
+        for (size_t c = 1; c < m_cellStart.size(); c++)
+            m_cellStart[c] += m_cellStart[c - 1];
+
+        vector<int> next( m_cellStart.begin(), m_cellStart.end() - 1 );
+        m_indices.resize( count );
+        m_x.resize( count );
+        m_y.resize( count );
+
+        for (size_t i = 0; i < count; i++)
+        {
+            int slot = next[ cellOf[i] ]++;
+            m_indices[slot] = i;
+            m_x[slot] = x[i];
+            m_y[slot] = y[i];
+        }
+    }
+
+    // Highest index within radius of (px, py), -1 if there is none.
+    // Same point the old scan over the visible set ended on.
+    //--------------------------------------------------------------
+    int findLast( float px, float py, float radius )
+    {
+        m_numQueries++;
+
+        if ( m_indices.empty() ||
+             px + radius < m_minX || px - radius >= m_minX + m_cols * m_cellSize ||
+             py + radius < m_minY || py - radius >= m_minY + m_rows * m_cellSize )
+            return -1;
+
+        int r0 = rowOf( py - radius ), r1 = rowOf( py + radius );
+        int c0 = colOf( px - radius ), c1 = colOf( px + radius );
+        int last = -1;
+
+        for (int r = r0; r <= r1; r++)
+        {
+            int begin = m_cellStart[ r * m_cols + c0 ];
+            int end   = m_cellStart[ r * m_cols + c1 + 1 ];
+            m_numTested += end - begin;
+
+            for (int k = begin; k < end; k++)
+            {
+                float dx = m_x[k] - px;
+                float dy = m_y[k] - py;
+
+                if ( dx * dx + dy * dy <= radius * radius )
+                    last = std::max( last, m_indices[k] );
+            }
+        }
+
+        return last;
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return m_indices.size(); }
+
+    //--------------------------------------------------------------
+    int getNumCells() const
+        { return m_rows * m_cols; }
+
+    // Queries and points tested by them since the last build
+    //--------------------------------------------------------------
+    size_t getNumQueries() const
+        { return m_numQueries; }
+
+    //--------------------------------------------------------------
+    size_t getNumTested() const
+        { return m_numTested; }
+
+private:
+
+    //--------------------------------------------------------------
+    int rowOf( float y ) const
+        { return std::max( 0, std::min( int( floorf( (y - m_minY) / m_cellSize ) ), m_rows - 1 ) ); }
+
+    //--------------------------------------------------------------
+    int colOf( float x ) const
+        { return std::max( 0, std::min( int( floorf( (x - m_minX) / m_cellSize ) ), m_cols - 1 ) ); }
+
+    float   m_minX;
+    float   m_minY;
+    float   m_cellSize;
+    int     m_rows;
+    int     m_cols;
+
+    vector<int>     m_cellStart;    // first slot of each cell, one extra at the end
+    vector<int>     m_indices;      // visible set indices sorted by cell
+    vector<float>   m_x;            // positions in the same order
+    vector<float>   m_y;
+
+    size_t  m_numQueries;
+    size_t  m_numTested;
+};
@@ -0,0 +1,217 @@
+//
+//  StreetViewAtlas.h
+//
+//  3/26/14.
+//
+//
+//  Offline street views packed into one file (see tools/streetViewPacker.cpp)
+//  and memory mapped, instead of one image file per point to open and decode.
+//  Every thumbnail is raw RGB of the same size, read straight from the mapping.
+//  The sampled color of the full size image is stored with it, so loading
+//  needs no decode at all.
+//
+//  Layout, native little endian:
+//      StreetViewAtlasHeader
+//      StreetViewAtlasEntry    entries[count]
+//      uint8_t                 pixels[count][size][size][3], page aligned
+
+#pragma once
+
+#include <fstream>
+
+#include "ofMain.h"
+#include "MappedFile.h"
+#include "CityPointStore.h"
+
+#define STREETVIEWATLAS_MAGIC   0x41535743      // "CWSA"
+#define STREETVIEWATLAS_VERSION 1
+
+// thumbnails that can be drawn in one frame, one per finger
+#define STREETVIEWATLAS_TEXTURES 20
+
+typedef struct StreetViewAtlasHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t thumbnailSize;
+    uint64_t entryOffset;
+    uint64_t pixelOffset;
+    uint64_t fileSize;
+} StreetViewAtlasHeader;
+
+// Location as read from cityData and the color sampled at 65, 65 of the full image
+typedef struct StreetViewAtlasEntry
+{
+    float    latitude;
+    float    longitude;
+    uint8_t  color[4];
+} StreetViewAtlasEntry;
+
+
+class StreetViewAtlas
+{
+public:
+
+    StreetViewAtlas()
+    {
+        m_thumbnailSize = 0;
+        m_pixels        = NULL;
+        m_useTexture    = true;
+        std::fill( m_textureIds, m_textureIds + STREETVIEWATLAS_TEXTURES, -1 );
+    }
+
+    // pixels holds the thumbnails of entries in the same order
+    //--------------------------------------------------------------
+    static bool save( const vector<StreetViewAtlasEntry> &entries, const vector<unsigned char> &pixels,
+                      int thumbnailSize, string filename )
+    {
+        size_t thumbnailBytes = (size_t)thumbnailSize * thumbnailSize * 3;
+        if ( pixels.size() != entries.size() * thumbnailBytes )
+            return false;
+
+        StreetViewAtlasHeader header;
+        header.magic         = STREETVIEWATLAS_MAGIC;
+        header.version       = STREETVIEWATLAS_VERSION;
+        header.count         = entries.size();
+        header.thumbnailSize = thumbnailSize;
+        header.entryOffset   = sizeof(StreetViewAtlasHeader);
+        header.pixelOffset   = align( header.entryOffset + entries.size() * sizeof(StreetViewAtlasEntry), 4096 );
+        header.fileSize      = header.pixelOffset + pixels.size();
+
+        vector<char> front( header.pixelOffset, 0 );
+        memcpy( &front[0], &header, sizeof(header) );
+        if ( !entries.empty() )
+            memcpy( &front[ header.entryOffset ], &entries[0], entries.size() * sizeof(StreetViewAtlasEntry) );
+
+        ofstream file( ofToDataPath( filename ).c_str(), ios::binary );
+        file.write( &front[0], front.size() );
+        if ( !pixels.empty() )
+            file.write( (const char*)&pixels[0], pixels.size() );
+
+        return file.good();
+    }
+
+    // Maps the atlas and gives every point with a thumbnail its color, false
+    // if the file is missing, from another version or truncated
+    //--------------------------------------------------------------
+    bool load( CityPointStore &points, string filename )
+    {
+        close();
+        if ( !m_file.open( filename ) || m_file.size() < sizeof(StreetViewAtlasHeader) )
+            return false;
+
+        StreetViewAtlasHeader header;
+        memcpy( &header, m_file.data(), sizeof(header) );
+
+        if ( header.magic != STREETVIEWATLAS_MAGIC || header.version != STREETVIEWATLAS_VERSION ||
+             header.fileSize != m_file.size() || header.thumbnailSize == 0 ||
+             header.entryOffset + (uint64_t)header.count * sizeof(StreetViewAtlasEntry) > header.pixelOffset ||
+             header.pixelOffset + (uint64_t)header.count * header.thumbnailSize * header.thumbnailSize * 3 != m_file.size() )
+        {
+            ofLogError("StreetViewAtlas") << filename << " is not a version " << STREETVIEWATLAS_VERSION << " street view atlas";
+            close();
+            return false;
+        }
+
+        m_thumbnailSize = header.thumbnailSize;
+        m_pixels        = (const unsigned char*)( m_file.data() + header.pixelOffset );
+        m_slotOf.assign( points.size(), -1 );
+
+        // thumbnails without a point are never looked up
+        const StreetViewAtlasEntry *entries = (const StreetViewAtlasEntry*)( m_file.data() + header.entryOffset );
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            int id = points.findPoint( entries[i].latitude, entries[i].longitude );
+            if ( id < 0 )
+                continue;
+
+            m_slotOf[id]     = i;
+            points.color[id] = ofColor( entries[i].color[0], entries[i].color[1],
+                                        entries[i].color[2], entries[i].color[3] );
+        }
+
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    void close()
+    {
+        m_file.close();
+        m_slotOf.clear();
+        m_thumbnailSize = 0;
+        m_pixels        = NULL;
+        std::fill( m_textureIds, m_textureIds + STREETVIEWATLAS_TEXTURES, -1 );
+    }
+
+    //--------------------------------------------------------------
+    bool isLoaded() const
+        { return m_pixels != NULL; }
+
+    //--------------------------------------------------------------
+    bool hasThumbnail( int pointId ) const
+    {
+        return pointId >= 0 && pointId < (int)m_slotOf.size() && m_slotOf[pointId] >= 0;
+    }
+
+    // RGB pixels of a point's thumbnail inside the mapping, NULL for none
+    //--------------------------------------------------------------
+    const unsigned char* getThumbnail( int pointId ) const
+    {
+        if ( !hasThumbnail( pointId ) )
+            return NULL;
+
+        return m_pixels + (size_t)m_slotOf[pointId] * m_thumbnailSize * m_thumbnailSize * 3;
+    }
+
+    //--------------------------------------------------------------
+    int getThumbnailSize() const
+        { return m_thumbnailSize; }
+
+    // Off when there is no GL context, getTexture() returns NULL then
+    //--------------------------------------------------------------
+    void setUseTexture( bool useTexture )
+        { m_useTexture = useTexture; }
+
+    // The thumbnail as the texture of a draw slot, uploaded from the mapping
+    // when the slot's point changes - main thread. Every slot has its own
+    // texture, valid until the next call for the same slot with another point,
+    // so the images of one frame can all be drawn after they are looked up.
+    //--------------------------------------------------------------
+    ofTexture* getTexture( int pointId, int slot = 0 )
+    {
+        const unsigned char *pixels = getThumbnail( pointId );
+        if ( !pixels || !m_useTexture )
+            return NULL;
+
+        slot %= STREETVIEWATLAS_TEXTURES;
+        ofTexture &texture = m_textures[slot];
+        if ( pointId != m_textureIds[slot] )
+        {
+            if ( !texture.isAllocated() )
+                texture.allocate( m_thumbnailSize, m_thumbnailSize, GL_RGB );
+
+            texture.loadData( pixels, m_thumbnailSize, m_thumbnailSize, GL_RGB );
+            m_textureIds[slot] = pointId;
+        }
+
+        return &texture;
+    }
+
+private:
+
+    //--------------------------------------------------------------
+    static uint64_t align( uint64_t offset, uint64_t alignment )
+    {
+        return ( offset + alignment - 1 ) & ~( alignment - 1 );
+    }
+
+    MappedFile              m_file;
+    vector<int>             m_slotOf;       // atlas slot of every point, -1 for none
+    int                     m_thumbnailSize;
+    const unsigned char    *m_pixels;
+
+    ofTexture               m_textures[STREETVIEWATLAS_TEXTURES];
+    int                     m_textureIds[STREETVIEWATLAS_TEXTURES];    // point uploaded to each texture
+    bool                    m_useTexture;
+};
@@ -0,0 +1,455 @@
+//
+//  StreetViewCache.h
+//
+//  3/26/14.
+//
+//
+//  Persistent cache of decoded street view thumbnails and their palette color.
+//  Entries are keyed by the quantized location and named after it on disk,
+//  one file per entry, so the same spot is downloaded and decoded only once
+//  across sessions. An LRU of decoded pixels sits in front of the files, and
+//  both layers evict their least recently used entries past their budgets.
+//  The modification time of a file is its last use, set on every hit, so
+//  the disk order survives a restart.
+//  Thread safe - StreetViewFetcher's workers use it directly. The lock only
+//  covers the index and the LRU orders, files are read and written outside.
+
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <list>
+#include <fstream>
+
+#include "ofMain.h"
+
+#ifdef TARGET_WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#include <sys/stat.h>
+#include "GeoKey.h"
+
+#define STREETVIEWCACHE_MAGIC   0x43565753      // "SWVC"
+#define STREETVIEWCACHE_VERSION 1
+
+// Header of one cache file, raw pixels follow
+typedef struct StreetViewCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int32_t  width;
+    int32_t  height;
+    int32_t  channels;
+    uint8_t  palette[4];
+} StreetViewCacheHeader;
+
+
+class StreetViewCache
+{
+public:
+
+    StreetViewCache()
+    {
+        m_imageSize    = 50;
+        m_memoryBudget = 0;
+        m_diskBudget   = 0;
+        m_memoryBytes  = 0;
+        m_diskBytes    = 0;
+
+        m_numMemoryHits = 0;
+        m_numDiskHits   = 0;
+        m_numMisses     = 0;
+        m_numEvictions  = 0;
+        m_numStores     = 0;
+        m_hitMicros     = 0;
+    }
+
+    // Indexes the entries already in directory (relative to bin/data) for
+    // thumbnails of imageSize, budgets are in bytes
+    //--------------------------------------------------------------
+    void setup( const string &directory, int imageSize, size_t memoryBudget, size_t diskBudget )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+
+        m_directory    = ofToDataPath( directory, true ) + "/";
+        m_imageSize    = imageSize;
+        m_memoryBudget = memoryBudget;
+        m_diskBudget   = diskBudget;
+
+        ofDirectory::createDirectory( m_directory, false, true );
+
+        // files of earlier sessions, least recently used - oldest modification time - first
+        ofDirectory dir( m_directory );
+        dir.allowExt( "svc" );
+        dir.listDir();
+
+        vector< pair<time_t, int> > files;
+        string suffix = "_" + ofToString( m_imageSize ) + ".svc";
+        for (int i = 0; i < dir.size(); i++)
+        {
+            string name = dir.getName( i );
+            if ( name.size() != 16 + suffix.size() || name.compare( 16, string::npos, suffix ) != 0 )
+                continue;
+
+            struct stat info;
+            if ( stat( ( m_directory + name ).c_str(), &info ) == 0 )
+                files.push_back( make_pair( info.st_mtime, i ) );
+        }
+        std::stable_sort( files.begin(), files.end() );
+
+        for (size_t f = 0; f < files.size(); f++)
+        {
+            int    i   = files[f].second;
+            GeoKey key = strtoull( dir.getName( i ).substr( 0, 16 ).c_str(), NULL, 16 );
+            touch( m_disk, m_diskOrder, key, dir.getFile( i ).getSize() );
+            m_diskBytes += m_disk.find( key )->bytes;
+        }
+
+        vector<GeoKey> removed;
+        evict( m_disk, m_diskOrder, m_diskBytes, m_diskBudget, &removed );
+
+        lock.unlock();
+        removeFiles( removed );
+    }
+
+    // Pixels and palette of key, from memory or disk
+    //--------------------------------------------------------------
+    bool find( GeoKey key, ofPixels &pixels, ofColor &palette )
+    {
+        uint64_t start = ofGetElapsedTimeMicros();
+        bool     memoryHit;
+        size_t   stored = 0;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+
+            MemoryEntry *entry = m_memory.find( key );
+            DiskEntry   *file  = m_disk.find( key );
+            memoryHit = entry != NULL;
+
+            if ( entry )
+            {
+                pixels  = entry->pixels;
+                palette = entry->palette;
+                touch( m_memory, m_memoryOrder, key, entry->bytes );
+
+                m_numMemoryHits++;
+                m_hitMicros += ofGetElapsedTimeMicros() - start;
+            }
+            else if ( !file )
+            {
+                m_numMisses++;
+                return false;
+            }
+
+            // the file of a memory hit may have been evicted already
+            if ( !file )
+                return true;
+
+            stored = file->stored;
+            if ( memoryHit )
+                touch( m_disk, m_diskOrder, key, file->bytes );
+        }
+
+        if ( memoryHit )
+        {
+            stamp( key );
+            return true;
+        }
+
+        bool loaded = read( key, pixels, palette );
+
+        vector<GeoKey> removed;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+
+            DiskEntry *file = m_disk.find( key );
+            if ( loaded )
+            {
+                if ( file )
+                    touch( m_disk, m_diskOrder, key, file->bytes );
+                remember( key, pixels, palette );
+
+                m_numDiskHits++;
+                m_hitMicros += ofGetElapsedTimeMicros() - start;
+            }
+            else
+            {
+                // unreadable, fetched again - unless it was stored anew meanwhile
+                if ( file && file->stored == stored )
+                {
+                    m_diskBytes -= file->bytes;
+                    m_diskOrder.erase( file->use );
+                    m_disk.erase( key );
+                    removed.push_back( key );
+                }
+                m_numMisses++;
+            }
+        }
+
+        if ( loaded )
+            stamp( key );
+        removeFiles( removed );
+
+        return loaded;
+    }
+
+    // Adds a freshly decoded thumbnail to both layers
+    //--------------------------------------------------------------
+    void store( GeoKey key, const ofPixels &pixels, const ofColor &palette )
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            remember( key, pixels, palette );
+        }
+
+        size_t bytes = write( key, pixels, palette );
+        if ( bytes == 0 )
+            return;
+
+        vector<GeoKey> removed;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+
+            DiskEntry *old = m_disk.find( key );
+            if ( old )
+                m_diskBytes -= old->bytes;
+
+            touch( m_disk, m_diskOrder, key, bytes );
+            m_disk.find( key )->stored = ++m_numStores;
+            m_diskBytes += bytes;
+            evict( m_disk, m_diskOrder, m_diskBytes, m_diskBudget, &removed );
+        }
+        removeFiles( removed );
+    }
+
+    // Counters since setup
+    //--------------------------------------------------------------
+    size_t getNumMemoryHits()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numMemoryHits;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumDiskHits()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numDiskHits;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumMisses()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numMisses;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumEvictions()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numEvictions;
+    }
+
+    // Mean time of a memory or disk hit in microseconds
+    //--------------------------------------------------------------
+    double getAverageHitTime()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        size_t hits = m_numMemoryHits + m_numDiskHits;
+        return hits ? (double)m_hitMicros / hits : 0;
+    }
+
+    //--------------------------------------------------------------
+    size_t getMemoryBytes()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_memoryBytes;
+    }
+
+    //--------------------------------------------------------------
+    size_t getDiskBytes()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_diskBytes;
+    }
+
+private:
+
+    typedef std::list<GeoKey> Order;      // most recently used first
+
+    typedef struct MemoryEntry
+    {
+        ofPixels        pixels;
+        ofColor         palette;
+        size_t          bytes;
+        Order::iterator use;
+    } MemoryEntry;
+
+    typedef struct DiskEntry
+    {
+        size_t          bytes;
+        size_t          stored;     // store() that wrote the file, 0 for earlier sessions
+        Order::iterator use;
+    } DiskEntry;
+
+    // Moves key to the front of order, adds it if missing
+    //--------------------------------------------------------------
+    template <class Entry>
+    void touch( GeoKeyMap<Entry> &entries, Order &order, GeoKey key, size_t bytes )
+    {
+        Entry *entry = entries.find( key );
+        if ( entry )
+        {
+            order.erase( entry->use );
+        }
+        else
+        {
+            entry = &entries[key];
+        }
+
+        order.push_front( key );
+        entry->use   = order.begin();
+        entry->bytes = bytes;
+    }
+
+    // A hit on key, its file first in the disk order after a restart - no lock
+    //--------------------------------------------------------------
+    void stamp( GeoKey key )
+    {
+        utime( getPath( key ).c_str(), NULL );
+    }
+
+    // Files of evicted entries, removed once the lock is released
+    //--------------------------------------------------------------
+    void removeFiles( const vector<GeoKey> &keys )
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+            ofFile::removeFile( getPath( keys[i] ), false );
+    }
+
+    // Drops least recently used entries until bytes fits in budget,
+    // collecting their keys in removed when they have files
+    //--------------------------------------------------------------
+    template <class Entry>
+    void evict( GeoKeyMap<Entry> &entries, Order &order, size_t &bytes, size_t budget, vector<GeoKey> *removed )
+    {
+        while ( bytes > budget && !order.empty() )
+        {
+            GeoKey key = order.back();
+            order.pop_back();
+
+            bytes -= entries.find( key )->bytes;
+            entries.erase( key );
+            m_numEvictions++;
+
+            if ( removed )
+                removed->push_back( key );
+        }
+    }
+
+    //--------------------------------------------------------------
+    void remember( GeoKey key, const ofPixels &pixels, const ofColor &palette )
+    {
+        MemoryEntry *old = m_memory.find( key );
+        if ( old )
+            m_memoryBytes -= old->bytes;
+
+        size_t bytes = (size_t)pixels.getWidth() * pixels.getHeight() * pixels.getNumChannels();
+        touch( m_memory, m_memoryOrder, key, bytes );
+
+        MemoryEntry *entry = m_memory.find( key );
+        entry->pixels  = pixels;
+        entry->palette = palette;
+
+        m_memoryBytes += bytes;
+        evict( m_memory, m_memoryOrder, m_memoryBytes, m_memoryBudget, NULL );
+    }
+
+    //--------------------------------------------------------------
+    string getPath( GeoKey key ) const
+    {
+        char name[32];
+        snprintf( name, sizeof(name), "%016llx", (unsigned long long)key );
+        return m_directory + name + "_" + ofToString( m_imageSize ) + ".svc";
+    }
+
+    // Written to a temporary file of the calling thread first, a crash or
+    // another writer never leaves half an entry
+    //--------------------------------------------------------------
+    size_t write( GeoKey key, const ofPixels &pixels, const ofColor &palette )
+    {
+        StreetViewCacheHeader header;
+        header.magic      = STREETVIEWCACHE_MAGIC;
+        header.version    = STREETVIEWCACHE_VERSION;
+        header.key        = key;
+        header.width      = pixels.getWidth();
+        header.height     = pixels.getHeight();
+        header.channels   = pixels.getNumChannels();
+        header.palette[0] = palette.r;
+        header.palette[1] = palette.g;
+        header.palette[2] = palette.b;
+        header.palette[3] = palette.a;
+
+        size_t size = (size_t)header.width * header.height * header.channels;
+        string path = getPath( key );
+        string temp = path + "." + ofToString( std::hash<std::thread::id>()( std::this_thread::get_id() ) ) + ".tmp";
+
+        std::ofstream file( temp.c_str(), std::ios::binary );
+        file.write( (const char*)&header, sizeof(header) );
+        file.write( (const char*)pixels.getPixels(), size );
+        file.close();
+
+        if ( !file || std::rename( temp.c_str(), path.c_str() ) != 0 )
+        {
+            ofLogWarning("StreetViewCache") << "could not write " << path;
+            return 0;
+        }
+
+        return sizeof(header) + size;
+    }
+
+    //--------------------------------------------------------------
+    bool read( GeoKey key, ofPixels &pixels, ofColor &palette )
+    {
+        std::ifstream file( getPath( key ).c_str(), std::ios::binary );
+
+        StreetViewCacheHeader header;
+        if ( !file.read( (char*)&header, sizeof(header) ) ||
+             header.magic != STREETVIEWCACHE_MAGIC || header.version != STREETVIEWCACHE_VERSION ||
+             header.key != key || header.width <= 0 || header.height <= 0 ||
+             header.channels < 1 || header.channels > 4 )
+            return false;
+
+        pixels.allocate( header.width, header.height, header.channels );
+        if ( !file.read( (char*)pixels.getPixels(), (size_t)header.width * header.height * header.channels ) )
+            return false;
+
+        palette = ofColor( header.palette[0], header.palette[1], header.palette[2], header.palette[3] );
+        return true;
+    }
+
+    std::mutex              m_mutex;
+    string                  m_directory;
+    int                     m_imageSize;
+
+    GeoKeyMap<MemoryEntry>  m_memory;
+    Order                   m_memoryOrder;
+    size_t                  m_memoryBytes;
+    size_t                  m_memoryBudget;
+
+    GeoKeyMap<DiskEntry>    m_disk;
+    Order                   m_diskOrder;
+    size_t                  m_diskBytes;
+    size_t                  m_diskBudget;
+
+    size_t                  m_numMemoryHits;
+    size_t                  m_numDiskHits;
+    size_t                  m_numMisses;
+    size_t                  m_numEvictions;
+    size_t                  m_numStores;
+    uint64_t                m_hitMicros;
+};
@@ -0,0 +1,494 @@
+//
+//  StreetViewFetcher.h
+//
+//  3/26/14.
+//
+//
+//  Street view images fetched off the render thread.
+//  Every finger is a slot that asks for the image at its location. Locations
+//  are quantized, so fingers over the same spot share one request and a
+//  finger resting in place asks only once. Requests still queued when their
+//  finger moves on are dropped. A small pool of worker threads downloads and
+//  decodes into pixels, update() turns the finished ones into images on
+//  the main thread. With a StreetViewCache, a location seen before is read
+//  back decoded instead of downloaded, along with its palette color.
+//  A failed download is asked for again while a finger still wants it,
+//  after a back-off that doubles with every failure.
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "ofMain.h"
+#include "GeoKey.h"
+#include "StreetViewCache.h"
+
+// about 11m, the size of the street view at 50x50
+#define STREETVIEW_QUANTUM 0.0001
+#define STREETVIEW_SIZE    50
+
+// images kept for drawing, the cache holds the rest
+#define STREETVIEW_MAX_IMAGES 64
+
+// wait before the first retry of a failed download, doubled up to 16 times that
+#define STREETVIEW_RETRY_MICROS 500000
+#define STREETVIEW_RETRY_DOUBLINGS 4
+
+class StreetViewFetcher
+{
+public:
+
+    StreetViewFetcher()
+    {
+        m_running      = false;
+        m_cache        = NULL;
+        m_numRequested = 0;
+        m_numCoalesced = 0;
+        m_numCancelled = 0;
+        m_numFetched   = 0;
+        m_numFailed    = 0;
+        m_numRetried   = 0;
+        m_fetchMicros  = 0;
+        m_useTexture   = true;
+    }
+
+    ~StreetViewFetcher()
+    {
+        stop();
+    }
+
+    // baseUrl is the street view endpoint, a local stand-in server for testing.
+    // cache is optional and shared with the workers, it has to outlive them.
+    //--------------------------------------------------------------
+    void setup( const string &baseUrl, const string &apiKey, int numThreads = 4, StreetViewCache *cache = NULL )
+    {
+        stop();
+
+        m_baseUrl = baseUrl;
+        m_apiKey  = apiKey;
+        m_cache   = cache;
+        m_running = true;
+
+        for (int i = 0; i < numThreads; i++)
+            m_workers.push_back( std::thread( &StreetViewFetcher::work, this ) );
+    }
+
+    // Images are pixels only when off, for running without a GL context
+    //--------------------------------------------------------------
+    void setUseTexture( bool useTexture )
+        { m_useTexture = useTexture; }
+
+    // Joins the workers, downloads in flight are finished first
+    //--------------------------------------------------------------
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_running = false;
+
+            // dropped requests can be asked for again after the next setup
+            for (size_t i = 0; i < m_queue.size(); i++)
+                m_states[ m_queue[i] ] = STATE_NONE;
+            m_queue.clear();
+        }
+        m_wake.notify_all();
+
+        for (size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i].join();
+        m_workers.clear();
+    }
+
+    // Image wanted by slot - main thread, every frame is fine
+    //--------------------------------------------------------------
+    void request( int slot, double lat, double lon )
+    {
+        if ( slot >= (int)m_slotKeys.size() )
+        {
+            m_slotKeys.resize( slot + 1, GeoKey( 0 ) );
+            m_slotPending.resize( slot + 1, GeoKey( 0 ) );
+            m_slotShown.resize( slot + 1, GeoKey( 0 ) );
+        }
+
+        GeoKey key = quantize( lat, lon );
+        GeoKey old = m_slotKeys[slot];
+        if ( key == old )
+            return;
+
+        m_slotKeys[slot]    = key;
+        m_slotPending[slot] = old;
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        // already loaded, downloading or queued for another finger
+        if ( m_images.count( key ) || m_states.get( key ) != STATE_NONE )
+        {
+            m_numCoalesced++;
+        }
+        else
+        {
+            enqueue( key );
+            m_numRequested++;
+        }
+
+        // the finger moved on, drop its old request unless it is already running
+        if ( m_states.get( old ) == STATE_QUEUED && !isWanted( old ) )
+        {
+            deque<GeoKey>::iterator it = std::find( m_queue.begin(), m_queue.end(), old );
+            if ( it != m_queue.end() )
+                m_queue.erase( it );
+
+            m_states[old] = STATE_NONE;
+            m_numCancelled++;
+            m_slotPending[slot] = GeoKey( 0 );
+        }
+    }
+
+    // Hands the decoded pixels over to images - main thread, once per frame
+    //--------------------------------------------------------------
+    void update()
+    {
+        vector<Result> done;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            done.swap( m_done );
+        }
+
+        uint64_t now = ofGetElapsedTimeMicros();
+        for (size_t i = 0; i < done.size(); i++)
+        {
+            GeoKey key = done[i].key;
+            if ( !done[i].loaded )
+            {
+                // the finger may rest on it, request() would not ask again
+                int     &failures = m_failures[key];
+                uint64_t backOff  = (uint64_t)STREETVIEW_RETRY_MICROS << std::min( failures, STREETVIEW_RETRY_DOUBLINGS );
+                Retry    failed   = { key, now + backOff };
+                m_retries.push_back( failed );
+                failures++;
+                continue;
+            }
+
+            m_failures.erase( key );
+            if ( !m_images.count( key ) )
+                m_imageOrder.push_back( key );
+
+            ofImage &image = m_images[key];
+            image.setUseTexture( m_useTexture );
+            image.setFromPixels( done[i].pixels );
+            m_palettes[key] = done[i].palette;
+
+            // a finger that moved on still shows its last download until the next one
+            for (size_t k = 0; k < m_slotPending.size(); k++)
+            {
+                if ( m_slotPending[k] == key )
+                    m_slotShown[k] = key;
+            }
+        }
+
+        retry( now );
+        prune();
+    }
+
+    // Latest image for slot - its current location if loaded, else the
+    // last one that arrived for it; NULL before the first one
+    //--------------------------------------------------------------
+    ofImage* get( int slot )
+    {
+        std::unordered_map<GeoKey, ofImage>::iterator it = m_images.find( getShownKey( slot ) );
+        return it != m_images.end() ? &it->second : NULL;
+    }
+
+    // Palette color of the same image, sampled when it was downloaded.
+    // palette is left as is before the first image.
+    //--------------------------------------------------------------
+    bool getPalette( int slot, ofColor &palette )
+    {
+        const ofColor *color = m_palettes.find( getShownKey( slot ) );
+        if ( color )
+            palette = *color;
+
+        return color != NULL;
+    }
+
+    //--------------------------------------------------------------
+    string getUrl( double lat, double lon ) const
+    {
+        return m_baseUrl + "?size=" + ofToString( STREETVIEW_SIZE ) + "x" + ofToString( STREETVIEW_SIZE ) +
+               "&location=" + ofToString( lat, 6 ) + "," + ofToString( lon, 6 ) +
+               "&sensor=false&key=" + m_apiKey;
+    }
+
+    // Counters since setup - requests sent to the workers, requests served by
+    // one already made, requests dropped before they ran, finished downloads
+    //--------------------------------------------------------------
+    size_t getNumRequested() const
+        { return m_numRequested; }
+
+    //--------------------------------------------------------------
+    size_t getNumCoalesced() const
+        { return m_numCoalesced; }
+
+    //--------------------------------------------------------------
+    size_t getNumCancelled() const
+        { return m_numCancelled; }
+
+    //--------------------------------------------------------------
+    size_t getNumFetched()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numFetched;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumFailed()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numFailed;
+    }
+
+    // Failed downloads asked for again
+    //--------------------------------------------------------------
+    size_t getNumRetried() const
+        { return m_numRetried; }
+
+    // Mean download and decode time in microseconds, cache hits excluded
+    //--------------------------------------------------------------
+    double getAverageFetchTime()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        size_t fetches = m_numFetched + m_numFailed;
+        return fetches ? (double)m_fetchMicros / fetches : 0;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumQueued()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_queue.size();
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumImages() const
+        { return m_images.size(); }
+
+private:
+
+    enum State
+    {
+        STATE_NONE,
+        STATE_QUEUED,
+        STATE_LOADING,
+        STATE_DONE
+    };
+
+    typedef struct Result
+    {
+        GeoKey   key;
+        ofPixels pixels;
+        ofColor  palette;
+        bool     loaded;
+    } Result;
+
+    typedef struct Retry
+    {
+        GeoKey   key;
+        uint64_t time;      // not before
+    } Retry;
+
+    //--------------------------------------------------------------
+    static GeoKey quantize( double lat, double lon )
+    {
+        return makeGeoKey( round( lat / STREETVIEW_QUANTUM ) * STREETVIEW_QUANTUM,
+                           round( lon / STREETVIEW_QUANTUM ) * STREETVIEW_QUANTUM );
+    }
+
+    // Under the lock
+    //--------------------------------------------------------------
+    void enqueue( GeoKey key )
+    {
+        m_states[key] = STATE_QUEUED;
+        m_queue.push_back( key );
+        m_wake.notify_one();
+    }
+
+    // Queues the failed downloads whose back-off is over and that a finger
+    // still wants; the others are dropped, request() asks for them anew
+    //--------------------------------------------------------------
+    void retry( uint64_t now )
+    {
+        if ( m_retries.empty() )
+            return;
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        size_t kept = 0;
+        for (size_t i = 0; i < m_retries.size(); i++)
+        {
+            const Retry &failed = m_retries[i];
+            if ( !isWanted( failed.key ) )
+            {
+                m_failures.erase( failed.key );
+                continue;
+            }
+
+            if ( failed.time > now )
+            {
+                m_retries[kept++] = failed;
+                continue;
+            }
+
+            if ( m_states.get( failed.key ) == STATE_NONE && !m_images.count( failed.key ) )
+            {
+                enqueue( failed.key );
+                m_numRetried++;
+            }
+        }
+        m_retries.resize( kept );
+    }
+
+    //--------------------------------------------------------------
+    bool isWanted( GeoKey key ) const
+    {
+        return std::find( m_slotKeys.begin(), m_slotKeys.end(), key ) != m_slotKeys.end();
+    }
+
+    // Key of the image slot shows, 0 for none
+    //--------------------------------------------------------------
+    GeoKey getShownKey( int slot )
+    {
+        if ( slot >= (int)m_slotKeys.size() )
+            return GeoKey( 0 );
+
+        if ( m_images.count( m_slotKeys[slot] ) )
+            m_slotShown[slot] = m_slotKeys[slot];
+
+        return m_slotShown[slot];
+    }
+
+    // Drops the oldest images no finger uses past STREETVIEW_MAX_IMAGES,
+    // they come back from the cache when a finger returns
+    //--------------------------------------------------------------
+    void prune()
+    {
+        if ( m_images.size() <= STREETVIEW_MAX_IMAGES )
+            return;
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        size_t kept = 0;
+        for (size_t i = 0; i < m_imageOrder.size(); i++)
+        {
+            GeoKey key = m_imageOrder[i];
+            bool   used = isWanted( key ) ||
+                          std::find( m_slotPending.begin(), m_slotPending.end(), key ) != m_slotPending.end() ||
+                          std::find( m_slotShown.begin(),   m_slotShown.end(),   key ) != m_slotShown.end();
+
+            if ( m_images.size() > STREETVIEW_MAX_IMAGES && !used )
+            {
+                m_images.erase( key );
+                m_palettes.erase( key );
+                m_states[key] = STATE_NONE;
+            }
+            else
+            {
+                m_imageOrder[kept++] = key;
+            }
+        }
+        m_imageOrder.resize( kept );
+    }
+
+    // Worker thread - download and decode, no GL
+    //--------------------------------------------------------------
+    void work()
+    {
+        while ( true )
+        {
+            GeoKey key;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                while ( m_running && m_queue.empty() )
+                    m_wake.wait( lock );
+
+                if ( !m_running )
+                    return;
+
+                key = m_queue.front();
+                m_queue.pop_front();
+                m_states[key] = STATE_LOADING;
+            }
+
+            Result result;
+            result.key = key;
+
+            if ( m_cache && m_cache->find( key, result.pixels, result.palette ) )
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                result.loaded = true;
+                m_states[key] = STATE_DONE;
+                m_done.push_back( result );
+                continue;
+            }
+
+            uint64_t start = ofGetElapsedTimeMicros();
+            ofHttpResponse response = ofLoadURL( getUrl( geoKeyLatitude( key ), geoKeyLongitude( key ) ) );
+            result.loaded = response.status == 200 && ofLoadImage( result.pixels, response.data );
+
+            if ( result.loaded )
+            {
+                result.palette = result.pixels.getColor( STREETVIEW_SIZE / 2, STREETVIEW_SIZE / 2 );
+                if ( m_cache )
+                    m_cache->store( key, result.pixels, result.palette );
+            }
+
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_fetchMicros += ofGetElapsedTimeMicros() - start;
+            if ( result.loaded )
+            {
+                m_states[key] = STATE_DONE;
+                m_numFetched++;
+            }
+            else
+            {
+                // asked again the next time a finger gets there
+                m_states[key] = STATE_NONE;
+                m_numFailed++;
+            }
+            m_done.push_back( result );
+        }
+    }
+
+    string                      m_baseUrl;
+    string                      m_apiKey;
+    StreetViewCache            *m_cache;
+
+    // shared with the workers
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    vector<std::thread>         m_workers;
+    bool                        m_running;
+    deque<GeoKey>               m_queue;
+    GeoKeyMap<State>            m_states;
+    vector<Result>              m_done;
+
+    // main thread only
+    std::unordered_map<GeoKey, ofImage> m_images;   // nodes stay put, no image is copied
+    GeoKeyMap<ofColor>          m_palettes;
+    vector<GeoKey>              m_imageOrder;   // images oldest first
+    vector<GeoKey>              m_slotKeys;     // location each slot wants
+    vector<GeoKey>              m_slotPending;  // location it wanted before, maybe still downloading
+    vector<GeoKey>              m_slotShown;    // last location with an image
+    vector<Retry>               m_retries;      // failed downloads waiting out their back-off
+    GeoKeyMap<int>              m_failures;     // failures in a row per location
+    bool                        m_useTexture;
+
+    size_t                      m_numRequested;
+    size_t                      m_numCoalesced;
+    size_t                      m_numCancelled;
+    size_t                      m_numFetched;
+    size_t                      m_numFailed;
+    size_t                      m_numRetried;
+    uint64_t                    m_fetchMicros;
+};
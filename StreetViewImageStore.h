@@ -0,0 +1,392 @@
+//
+//  StreetViewImageStore.h
+//
+//  3/26/14.
+//
+//
+//  Offline street view images, paged in on demand.
+//  At load time every image is decoded once for its sampled color and
+//  dropped, only its path is kept. Images near the fingers are decoded by
+//  a worker thread, update() turns them into images on the main thread and
+//  an LRU drops the least recently used ones past the memory budget.
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <unordered_map>
+
+#include "ofMain.h"
+
+class StreetViewImageStore
+{
+public:
+
+    StreetViewImageStore()
+    {
+        m_running      = false;
+        m_memoryBudget = 0;
+        m_memoryBytes  = 0;
+        m_imageBytes   = 0;
+        m_frame        = 0;
+        m_useTexture   = true;
+
+        m_numHits      = 0;
+        m_numMisses    = 0;
+        m_numDecoded   = 0;
+        m_numFailed    = 0;
+        m_numEvictions = 0;
+    }
+
+    ~StreetViewImageStore()
+    {
+        stop();
+    }
+
+    // Image file of a point, called by Utils::loadImages
+    //--------------------------------------------------------------
+    void add( int pointId, const string &path )
+    {
+        if ( pointId >= (int)m_imageOf.size() )
+            m_imageOf.resize( pointId + 1, -1 );
+
+        if ( m_imageOf[pointId] < 0 )
+        {
+            m_imageOf[pointId] = m_paths.size();
+            m_paths.push_back( path );
+            m_states.push_back( STATE_NONE );
+        }
+        else
+        {
+            m_paths[ m_imageOf[pointId] ] = path;
+        }
+    }
+
+    // Starts the decode threads, memoryBudget is in bytes of decoded pixels
+    //--------------------------------------------------------------
+    void setup( size_t memoryBudget, int numThreads = 2 )
+    {
+        stop();
+
+        m_memoryBudget = memoryBudget;
+        m_running      = true;
+
+        for (int i = 0; i < numThreads; i++)
+            m_workers.push_back( std::thread( &StreetViewImageStore::work, this ) );
+    }
+
+    // Images are pixels only when off, for running without a GL context
+    //--------------------------------------------------------------
+    void setUseTexture( bool useTexture )
+        { m_useTexture = useTexture; }
+
+    // Joins the workers, decodes in flight are finished first
+    //--------------------------------------------------------------
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_running = false;
+
+            for (size_t i = 0; i < m_queue.size(); i++)
+                m_states[ m_queue[i] ] = STATE_NONE;
+            m_queue.clear();
+        }
+        m_wake.notify_all();
+
+        for (size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i].join();
+        m_workers.clear();
+    }
+
+    //--------------------------------------------------------------
+    bool hasImage( int pointId ) const
+    {
+        return pointId >= 0 && pointId < (int)m_imageOf.size() && m_imageOf[pointId] >= 0;
+    }
+
+    // Image file of a point, empty for none
+    //--------------------------------------------------------------
+    const string& getPath( int pointId ) const
+    {
+        static const string none;
+        return hasImage( pointId ) ? m_paths[ m_imageOf[pointId] ] : none;
+    }
+
+    // Points near the fingers, decoded in the given order ahead of use and
+    // kept over older images. Replaces the points still queued from the
+    // frame before, stops at half the budget so prefetching never evicts
+    // what it just decoded.
+    //--------------------------------------------------------------
+    void prefetch( const vector<int> &pointIds )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        for (size_t i = 0; i < m_queue.size(); i++)
+            m_states[ m_queue[i] ] = STATE_NONE;
+        m_queue.clear();
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < pointIds.size() && bytes + m_imageBytes <= m_memoryBudget / 2; i++)
+        {
+            if ( !hasImage( pointIds[i] ) )
+                continue;
+
+            int      image = m_imageOf[ pointIds[i] ];
+            Resident *entry = findResident( image );
+            if ( entry )
+            {
+                if ( entry->lastUse != m_frame )
+                    bytes += entry->bytes;
+                touch( image, entry );
+            }
+            else if ( m_states[image] == STATE_NONE )
+            {
+                enqueue( image, false );
+                bytes += m_imageBytes;
+            }
+        }
+
+        if ( !m_queue.empty() )
+            m_wake.notify_all();
+    }
+
+    // Image of a point if it is resident - main thread. A missing one is
+    // decoded ahead of the prefetched ones, NULL until it arrives.
+    // Pointers stay valid until the next update().
+    //--------------------------------------------------------------
+    ofImage* get( int pointId )
+    {
+        if ( !hasImage( pointId ) )
+            return NULL;
+
+        int      image = m_imageOf[pointId];
+        Resident *entry = findResident( image );
+        if ( entry )
+        {
+            touch( image, entry );
+            m_numHits++;
+            return &entry->image;
+        }
+
+        m_numMisses++;
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+        enqueue( image, true );
+        m_wake.notify_one();
+        return NULL;
+    }
+
+    // Hands the decoded pixels over to images and evicts past the
+    // budget - main thread, once per frame before anything calls get()
+    //--------------------------------------------------------------
+    void update()
+    {
+        m_frame++;
+
+        vector<Result> done;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            done.swap( m_done );
+        }
+
+        for (size_t i = 0; i < done.size(); i++)
+        {
+            // decoded twice if asked for again before the first one arrived
+            if ( !done[i].loaded || findResident( done[i].image ) )
+                continue;
+
+            Resident &entry = m_images[ done[i].image ];
+            entry.image.setUseTexture( m_useTexture );
+            entry.image.setFromPixels( done[i].pixels );
+            entry.bytes = (size_t)done[i].pixels.getWidth() * done[i].pixels.getHeight() *
+                          done[i].pixels.getNumChannels();
+            m_order.push_front( done[i].image );
+            entry.use     = m_order.begin();
+            entry.lastUse = m_frame;
+
+            m_memoryBytes += entry.bytes;
+            m_imageBytes   = entry.bytes;
+        }
+
+        // never the ones used last frame, they may still be on screen
+        while ( m_memoryBytes > m_memoryBudget && !m_order.empty() )
+        {
+            int      image = m_order.back();
+            Resident *entry = findResident( image );
+            if ( entry->lastUse + 1 >= m_frame )
+                break;
+
+            m_memoryBytes -= entry->bytes;
+            m_order.pop_back();
+            m_images.erase( image );
+            m_numEvictions++;
+        }
+    }
+
+    // Counters since load - get() answered from memory or not, finished and
+    // failed decodes, images dropped for the budget
+    //--------------------------------------------------------------
+    size_t getNumHits() const
+        { return m_numHits; }
+
+    //--------------------------------------------------------------
+    size_t getNumMisses() const
+        { return m_numMisses; }
+
+    //--------------------------------------------------------------
+    size_t getNumDecoded()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numDecoded;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumFailed()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_numFailed;
+    }
+
+    //--------------------------------------------------------------
+    size_t getNumEvictions() const
+        { return m_numEvictions; }
+
+    //--------------------------------------------------------------
+    size_t getNumImages() const
+        { return m_paths.size(); }
+
+    //--------------------------------------------------------------
+    size_t getNumResident() const
+        { return m_images.size(); }
+
+    //--------------------------------------------------------------
+    size_t getMemoryBytes() const
+        { return m_memoryBytes; }
+
+private:
+
+    enum State
+    {
+        STATE_NONE,
+        STATE_QUEUED,
+        STATE_LOADING,
+        STATE_FAILED        // not asked for again
+    };
+
+    typedef struct Resident
+    {
+        ofImage                 image;
+        size_t                  bytes;
+        size_t                  lastUse;    // frame
+        std::list<int>::iterator use;
+    } Resident;
+
+    typedef struct Result
+    {
+        int      image;
+        ofPixels pixels;
+        bool     loaded;
+    } Result;
+
+    // Queues an image that is neither resident nor on its way - m_mutex held
+    //--------------------------------------------------------------
+    void enqueue( int image, bool urgent )
+    {
+        if ( m_states[image] != STATE_NONE || findResident( image ) )
+            return;
+
+        m_states[image] = STATE_QUEUED;
+        if ( urgent )
+            m_queue.push_front( image );
+        else
+            m_queue.push_back( image );
+    }
+
+    // The decoded image, NULL when it is not in memory
+    //--------------------------------------------------------------
+    Resident* findResident( int image )
+    {
+        std::unordered_map<int, Resident>::iterator it = m_images.find( image );
+        return it != m_images.end() ? &it->second : NULL;
+    }
+
+    //--------------------------------------------------------------
+    void touch( int image, Resident *entry )
+    {
+        m_order.erase( entry->use );
+        m_order.push_front( image );
+        entry->use     = m_order.begin();
+        entry->lastUse = m_frame;
+    }
+
+    // Worker thread - decode only, no GL
+    //--------------------------------------------------------------
+    void work()
+    {
+        while ( true )
+        {
+            Result result;
+            string path;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                while ( m_running && m_queue.empty() )
+                    m_wake.wait( lock );
+
+                if ( !m_running )
+                    return;
+
+                result.image = m_queue.front();
+                m_queue.pop_front();
+                m_states[ result.image ] = STATE_LOADING;
+                path = m_paths[ result.image ];
+            }
+
+            result.loaded = ofLoadImage( result.pixels, path );
+
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( result.loaded )
+            {
+                m_states[ result.image ] = STATE_NONE;
+                m_numDecoded++;
+            }
+            else
+            {
+                ofLogWarning("StreetViewImageStore") << "could not decode " << path;
+                m_states[ result.image ] = STATE_FAILED;
+                m_numFailed++;
+            }
+            m_done.push_back( result );
+        }
+    }
+
+    // indexed at load time, read only afterwards
+    vector<int>                 m_imageOf;      // image of every point, -1 for none
+    vector<string>              m_paths;
+
+    // shared with the workers
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    vector<std::thread>         m_workers;
+    bool                        m_running;
+    deque<int>                  m_queue;
+    vector<State>               m_states;
+    vector<Result>              m_done;
+    size_t                      m_numDecoded;
+    size_t                      m_numFailed;
+
+    // main thread only
+    std::unordered_map<int, Resident> m_images; // by image, only the ones in memory
+    std::list<int>              m_order;        // most recently used first
+    size_t                      m_memoryBudget;
+    size_t                      m_memoryBytes;
+    size_t                      m_imageBytes;   // size of the last decoded image
+    size_t                      m_frame;
+    bool                        m_useTexture;
+
+    size_t                      m_numHits;
+    size_t                      m_numMisses;
+    size_t                      m_numEvictions;
+};
@@ -0,0 +1,337 @@
+//
+//  TaskPool.h
+//
+//  3/26/14.
+//
+//
+//  Work-stealing pool for the data-parallel loops of a frame.
+//  parallelFor() cuts a range into chunks and deals them out to the
+//  workers' queues. Every worker runs its own queue newest first and
+//  steals the oldest chunk of another queue when its own is empty, so a
+//  worker held up by a slow chunk does not hold up the loop. The calling
+//  thread runs chunks of its own loop until the loop is done - never those
+//  of other loops, which could be far longer - and a loop called from inside
+//  a chunk queues on its own worker, so loops nest. A loop of one grain or
+//  less runs in place.
+//  Every loop is timed by name: wall time, the time of its chunks and the
+//  slowest chunk, how many chunks ran away from the queue they were dealt to.
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "ofMain.h"
+
+// chunks per thread a loop is cut into at most, room to even out
+#define TASKPOOL_CHUNKS_PER_THREAD 4
+
+typedef std::function<void ( size_t begin, size_t end )> TaskRange;
+
+// Timings of all loops of one name
+typedef struct TaskPoolStats
+{
+    size_t   calls;
+    size_t   tasks;
+    size_t   stolen;            // chunks run by another thread than the one dealt to
+    uint64_t wallMicros;        // caller waiting for the loop
+    uint64_t taskMicros;        // sum over the chunks
+    uint64_t maxTaskMicros;
+} TaskPoolStats;
+
+
+class TaskPool
+{
+public:
+
+    TaskPool()
+    {
+        m_running  = false;
+        m_numQueued = 0;
+    }
+
+    ~TaskPool()
+    {
+        stop();
+    }
+
+    // Starts numWorkers threads, by default one per core besides the caller's
+    //--------------------------------------------------------------
+    void start( int numWorkers = -1 )
+    {
+        stop();
+
+        if ( numWorkers < 0 )
+            numWorkers = std::max( (int)std::thread::hardware_concurrency() - 1, 0 );
+
+        m_queues.clear();
+        for (int i = 0; i < numWorkers; i++)
+            m_queues.push_back( std::unique_ptr<Queue>( new Queue() ) );
+
+        m_running = true;
+        for (int i = 0; i < numWorkers; i++)
+            m_workers.push_back( std::thread( &TaskPool::work, this, i ) );
+    }
+
+    // Joins the workers - no loop may be running
+    //--------------------------------------------------------------
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_sleepMutex );
+            m_running = false;
+        }
+        m_wake.notify_all();
+
+        for (size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i].join();
+        m_workers.clear();
+    }
+
+    // Threads a loop runs on, the caller included
+    //--------------------------------------------------------------
+    int getNumThreads() const
+        { return m_workers.size() + 1; }
+
+    // body over [0, count) in chunks of at least grain, returns when all
+    // chunks are done. In place when there is only one chunk or no workers.
+    //--------------------------------------------------------------
+    void parallelFor( const char *name, size_t count, size_t grain, const TaskRange &body )
+    {
+        if ( count == 0 )
+            return;
+
+        uint64_t start = ofGetElapsedTimeMicros();
+
+        size_t maxChunks = (size_t)getNumThreads() * TASKPOOL_CHUNKS_PER_THREAD;
+        size_t numChunks = std::min( ( count + grain - 1 ) / std::max( grain, (size_t)1 ), maxChunks );
+
+        Job job( body );
+        if ( numChunks <= 1 || m_workers.empty() )
+        {
+            Task task = { &job, 0, count, -1 };
+            run( task, -1 );
+        }
+        else
+        {
+            job.remaining = numChunks;
+
+            // dealt round robin from the caller's own queue on, if it is a worker
+            int first = getWorkerIndex();
+            for (size_t c = 0; c < numChunks; c++)
+            {
+                int  queue = ( std::max( first, 0 ) + c ) % m_queues.size();
+                Task task  = { &job, count * c / numChunks, count * ( c + 1 ) / numChunks, queue };
+
+                std::lock_guard<std::mutex> lock( m_queues[queue]->mutex );
+                m_queues[queue]->tasks.push_back( task );
+            }
+            {
+                std::lock_guard<std::mutex> lock( m_sleepMutex );
+                m_numQueued += numChunks;
+            }
+            m_wake.notify_all();
+
+            // help until every chunk is done, with chunks of this loop only
+            while ( job.remaining > 0 )
+            {
+                Task task;
+                if ( next( first, task, &job ) )
+                    run( task, first );
+                else
+                    std::this_thread::yield();
+            }
+        }
+
+        record( name, job, ofGetElapsedTimeMicros() - start );
+    }
+
+    // Timings by loop name - any thread
+    //--------------------------------------------------------------
+    map<string, TaskPoolStats> getStats()
+    {
+        std::lock_guard<std::mutex> lock( m_statsMutex );
+        return m_stats;
+    }
+
+    //--------------------------------------------------------------
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock( m_statsMutex );
+        m_stats.clear();
+    }
+
+    //--------------------------------------------------------------
+    void logStats( const string &module )
+    {
+        map<string, TaskPoolStats> stats = getStats();
+        for (map<string, TaskPoolStats>::iterator it = stats.begin(); it != stats.end(); ++it)
+        {
+            const TaskPoolStats &s = it->second;
+            ofLogNotice( module ) << it->first << ": " << s.calls << " loops, "
+                                  << s.wallMicros / std::max( s.calls, (size_t)1 ) << "us average, "
+                                  << s.tasks / std::max( s.calls, (size_t)1 ) << " chunks of "
+                                  << s.taskMicros / std::max( s.tasks, (size_t)1 ) << "us, "
+                                  << s.maxTaskMicros << "us slowest, "
+                                  << s.stolen << " stolen, on " << getNumThreads() << " threads";
+        }
+    }
+
+private:
+
+    // One parallelFor call, on the caller's stack until its chunks are done
+    struct Job
+    {
+        Job( const TaskRange &b ) : body( b ), remaining( 0 ), taskMicros( 0 ),
+                                    maxTaskMicros( 0 ), tasks( 0 ), stolen( 0 ) {}
+
+        const TaskRange         &body;
+        std::atomic<size_t>     remaining;
+        std::atomic<uint64_t>   taskMicros;
+        std::atomic<uint64_t>   maxTaskMicros;
+        std::atomic<size_t>     tasks;
+        std::atomic<size_t>     stolen;
+    };
+
+    typedef struct Task
+    {
+        Job    *job;
+        size_t  begin;
+        size_t  end;
+        int     queue;      // dealt to, -1 for run in place
+    } Task;
+
+    struct Queue
+    {
+        std::mutex      mutex;
+        deque<Task>     tasks;
+    };
+
+    // Worker of the calling thread, -1 for none
+    //--------------------------------------------------------------
+    int getWorkerIndex() const
+    {
+        std::thread::id self = std::this_thread::get_id();
+        for (size_t i = 0; i < m_workers.size(); i++)
+        {
+            if ( m_workers[i].get_id() == self )
+                return i;
+        }
+        return -1;
+    }
+
+    // The newest chunk of the own queue, else the oldest of another.
+    // Only chunks of job when one is given.
+    //--------------------------------------------------------------
+    bool next( int self, Task &task, const Job *job = NULL )
+    {
+        int count = m_queues.size();
+        for (int k = 0; k < count; k++)
+        {
+            int   index = ( std::max( self, 0 ) + k ) % count;
+            Queue &queue = *m_queues[index];
+
+            std::lock_guard<std::mutex> lock( queue.mutex );
+            if ( queue.tasks.empty() )
+                continue;
+
+            deque<Task>::iterator it;
+            if ( index == self )
+            {
+                it = queue.tasks.end();
+                while ( it != queue.tasks.begin() && job && ( it - 1 )->job != job )
+                    --it;
+                if ( it == queue.tasks.begin() )
+                    continue;
+                --it;
+            }
+            else
+            {
+                it = queue.tasks.begin();
+                while ( it != queue.tasks.end() && job && it->job != job )
+                    ++it;
+                if ( it == queue.tasks.end() )
+                    continue;
+            }
+
+            task = *it;
+            queue.tasks.erase( it );
+
+            std::lock_guard<std::mutex> sleepLock( m_sleepMutex );
+            m_numQueued--;
+            return true;
+        }
+        return false;
+    }
+
+    //--------------------------------------------------------------
+    void run( const Task &task, int self )
+    {
+        Job &job = *task.job;
+
+        uint64_t start = ofGetElapsedTimeMicros();
+        job.body( task.begin, task.end );
+        uint64_t time = ofGetElapsedTimeMicros() - start;
+
+        job.taskMicros += time;
+        job.tasks++;
+        if ( task.queue >= 0 && task.queue != self )
+            job.stolen++;
+
+        uint64_t slowest = job.maxTaskMicros;
+        while ( time > slowest && !job.maxTaskMicros.compare_exchange_weak( slowest, time ) ) {}
+
+        // last, the caller may return and take job with it right after
+        if ( task.queue >= 0 )
+            job.remaining--;
+    }
+
+    //--------------------------------------------------------------
+    void record( const char *name, const Job &job, uint64_t wallMicros )
+    {
+        std::lock_guard<std::mutex> lock( m_statsMutex );
+
+        TaskPoolStats &s = m_stats[name];
+        s.calls++;
+        s.tasks         += job.tasks;
+        s.stolen        += job.stolen;
+        s.wallMicros    += wallMicros;
+        s.taskMicros    += job.taskMicros;
+        s.maxTaskMicros  = std::max( s.maxTaskMicros, (uint64_t)job.maxTaskMicros );
+    }
+
+    //--------------------------------------------------------------
+    void work( int self )
+    {
+        while ( true )
+        {
+            Task task;
+            if ( next( self, task ) )
+            {
+                run( task, self );
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock( m_sleepMutex );
+            while ( m_running && m_numQueued == 0 )
+                m_wake.wait( lock );
+
+            if ( !m_running )
+                return;
+        }
+    }
+
+    vector<std::unique_ptr<Queue>>  m_queues;       // one per worker
+    vector<std::thread>             m_workers;
+
+    std::mutex                      m_sleepMutex;
+    std::condition_variable         m_wake;
+    bool                            m_running;
+    size_t                          m_numQueued;    // chunks in all queues
+
+    std::mutex                      m_statsMutex;
+    map<string, TaskPoolStats>      m_stats;
+};
@@ -0,0 +1,66 @@
+//
+//  TripleBuffer.h
+//
+//  3/26/14.
+//
+//
+//  Lock-free handoff of the latest value from one writer thread to one
+//  reader thread. The writer fills the back slot and publishes it, the
+//  reader takes the newest published slot. Neither side ever waits or
+//  allocates, values the reader never took are overwritten.
+
+#pragma once
+
+#include <atomic>
+
+template <class T>
+class TripleBuffer
+{
+public:
+
+    TripleBuffer()
+    {
+        m_back   = 0;
+        m_middle = 1;
+        m_front  = 2;
+    }
+
+    // Writer - the slot to fill, it keeps whatever it held three publishes ago
+    //--------------------------------------------------------------
+    T& getBack()
+        { return m_slots[m_back]; }
+
+    // Writer - hands the back slot over, the reader sees it on its next update()
+    //--------------------------------------------------------------
+    void publish()
+    {
+        m_back = m_middle.exchange( m_back | FRESH, std::memory_order_acq_rel ) & INDEX;
+    }
+
+    // Reader - takes the newest published slot, false if nothing was published since
+    //--------------------------------------------------------------
+    bool update()
+    {
+        if ( !( m_middle.load( std::memory_order_acquire ) & FRESH ) )
+            return false;
+
+        m_front = m_middle.exchange( m_front, std::memory_order_acq_rel ) & INDEX;
+        return true;
+    }
+
+    // Reader - the slot taken by the last update(), untouched by the writer
+    //--------------------------------------------------------------
+    const T& getFront() const
+        { return m_slots[m_front]; }
+
+private:
+
+    // slot index in the low bits, FRESH while the middle slot is unread
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T                   m_slots[3];
+    int                 m_back;         // writer only
+    std::atomic<int>    m_middle;
+    int                 m_front;        // reader only
+};
@@ -10,78 +10,156 @@
 // Util & Config functions
 namespace Utils {
     
-    void loadColors( std::map<string,GeoData> &streetData, vector<ofPoint> &coordinates,
-                    std::string filename )
+    void loadColors( CityPointStore &points, std::string filename )
     {
         ofBuffer file = ofBufferFromFile( filename );
-    
-        // Loop through text lines
-        while ( !file.isLastLine() )
-        {
-            vector <string> values = ofSplitString(file.getNextLine(), ",");
+        const char *text = file.getBinaryBuffer();
         
-            float lat = ofToFloat(values[0]);
-            float lon = ofToFloat(values[1]);
+        vector<CsvRow> rows;
+        CsvIngest::parse( file, rows, filename );
         
-            coordinates.push_back( ofPoint(lat, lon) );
-
-            std::string str = ofToString(lat) + "," + ofToString(lon);
-
-            GeoData geoData = {values[2], values[3]};
-            streetData[str] = geoData;
+        points.reserve( points.size() + rows.size() );
+        
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            const CsvRow &row = rows[i];
+            if ( row.fieldCount < 4 )
+                continue;
+            
+            int street = points.intern( text + row.fieldStart[2], row.fieldLength[2] );
+            int city   = points.intern( text + row.fieldStart[3], row.fieldLength[3] );
+            
+            // a repeated location stays one point with the latest names,
+            // a second slot would never get a color or elevation
+            int id = points.findPoint( row.lat, row.lon );
+            if ( id >= 0 )
+            {
+                points.streetId[id] = street;
+                points.cityId[id]   = city;
+                continue;
+            }
+            
+            points.addPoint( row.lat, row.lon, street, city );
         }
     }
 
-    void loadImages( std::map<std::string,ofColor> &colorData, std::map<std::string,ofImage> &imageData,
+    // points have to be loaded first - colors go to the matching point.
+    // Every image is decoded once for its color, the store pages it in later.
+    void loadImages( CityPointStore &points, StreetViewImageStore &images,
                 std::string filename )
     {
         ofBuffer file = ofBufferFromFile( filename );
-    
-        // Loop through text lines
+        const char *text = file.getBinaryBuffer();
+        
+        vector<CsvRow> rows;
+        CsvIngest::parse( file, rows, filename );
 
-        while ( !file.isLastLine() )
+        ofPixels pixels;
+        for (size_t i = 0; i < rows.size(); i++)
         {
-            vector<std::string> values = ofSplitString(file.getNextLine(), ",");
+            const CsvRow &row = rows[i];
+            if ( row.fieldCount < 2 )
+                continue;
             
-            float lat = ofToFloat(values[0]);
-            float lon = ofToFloat(values[1]);
+            // images without a point are never looked up
+            int id = points.findPoint(row.lat, row.lon);
+            if ( id < 0 )
+                continue;
             
+            // file names use the coordinates as written in the data file
             std::string imagePath = "streetViewMap_"
-            + values[0]
+            + std::string( text + row.fieldStart[0], row.fieldLength[0] )
             + "_"
-            + values[1];
+            + std::string( text + row.fieldStart[1], row.fieldLength[1] );
         
-            std::string str = ofToString(lat) + "," + ofToString(lon);
+            // a file that does not decode here is not paged in later either
+            if ( !ofLoadImage( pixels, imagePath ) )
+                continue;
             
-            colorData[str] = ofImage(imagePath).getColor(65, 65);
-            imageData[str] = ofImage(imagePath);
+            points.color[id] = pixels.getColor(65, 65);
+            images.add( id, imagePath );
         }
     }
     
-    void loadElevations( std::map<std::string,float> &elevationData, std::string filename )
+    // points have to be loaded first - elevations without a point are dropped
+    void loadElevations( CityPointStore &points, std::string filename )
     {
-        ofBuffer file2 = ofBufferFromFile(filename);
-        while ( !file2.isLastLine() )
+        ofBuffer file = ofBufferFromFile( filename );
+        
+        vector<CsvRow> rows;
+        CsvIngest::parse( file, rows, filename );
+        
+        for (size_t i = 0; i < rows.size(); i++)
         {
-            vector <string> values = ofSplitString(file2.getNextLine(), ",");
+            const CsvRow &row = rows[i];
+            if ( row.fieldCount < 3 )
+                continue;
+            
+            int id = points.findPoint(row.lat, row.lon);
+            if ( id >= 0 )
+                points.elevation[id] = row.value;
+        }
+    }
+    
+    // Map colors for every point, once colors and streets are loaded.
+    // The cache color is the base color multiplied with a pseudo random
+    // color seeded by the street name length.
+    void computeDisplayColors( CityPointStore &points )
+    {
+        points.displayColor.resize( points.size() );
+        points.cacheColor.resize( points.size() );
+        
+        // srand/rand only depends on the street name length
+        map<size_t,ofPoint> streetColors;
+        
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            size_t length = points.getName( points.streetId[i] ).size();
+            
+            if ( streetColors.find( length ) == streetColors.end() )
+            {
+                // r
+                srand(length+1);
+                int r = rand() % (length+10);
+                
+                // g
+                srand(length+2);
+                int g = rand() % (length+20);
+                
+                // b
+                srand(length+3);
+                int b = rand() % (length+30);
+                
+                streetColors[length] = ofPoint( r, g, b );
+            }
             
-            float lat = ofToFloat(values[0]);
-            float lon = ofToFloat(values[1]);
+            const ofColor &baseClr   = points.color[i];
+            const ofPoint &streetClr = streetColors[length];
             
-            string str = ofToString(lat) + "," + ofToString(lon);
+            ofColor clr = ofColor( int(streetClr.x) * 56 * baseClr.r,
+                                   int(streetClr.y) * 56 * baseClr.g,
+                                   int(streetClr.z) * 36 * baseClr.b );
+            clr.setSaturation(320);
+            clr.setBrightness(200);
+            points.cacheColor[i] = clr;
             
-            elevationData[str] = ofToFloat(values[2]);
+            clr = ofColor( baseClr.r,
+                           baseClr.g,
+                           baseClr.b );
+            clr.setSaturation(320);
+            clr.setBrightness(200);
+            points.displayColor[i] = clr;
         }
     }
     
-    void citySetup( vector<City> cityLocations )
+    void citySetup( vector<City> &cityLocations )
     {
-        // have to add more cities
-        City seoul          = { 37.5833 ,   127.05   , "Seoul",         0 };
-        City shanghai       = { 31.233  ,   121.45   , "Shanghai",      1 };
-        City tokyo          = { 35.6833 ,   139.7333 , "Tokyo",         2 };
-        City lasvegas       = { 14.86667,   -88.06667, "Las Vegas",     3 };
-        City sanfrancisco   = { 37.77493,  -122.41942, "San Francisco", 4 };
+        // have to add more cities - name, id, lat, lon like City
+        City seoul          = { "Seoul",         0, 37.5833 ,   127.05    };
+        City shanghai       = { "Shanghai",      1, 31.233  ,   121.45    };
+        City tokyo          = { "Tokyo",         2, 35.6833 ,   139.7333  };
+        City lasvegas       = { "Las Vegas",     3, 14.86667,   -88.06667 };
+        City sanfrancisco   = { "San Francisco", 4, 37.77493,  -122.41942 };
     
         cityLocations.push_back( seoul        );      // Seoul
         cityLocations.push_back( shanghai     );      // Shanghai
@@ -0,0 +1,244 @@
+//
+//  VisibleSet.h
+//
+//  3/26/14.
+//
+//
+//  The points inside the view window and their projected positions, kept
+//  up to date incrementally while panning. Navigation moves the center by
+//  a few 1e-4 degrees per frame, so only the strips entering and leaving
+//  the window are queried from the grid. Points that leave are swapped out
+//  by their slot, entering ones are projected and the points that stay are
+//  not touched: their positions stay those of the last rebuild and the pan
+//  since then is one offset the consumers add.
+//  Large jumps (reset, city switch) and scale changes rebuild the set.
+
+#pragma once
+
+#include "ofMain.h"
+#include "GeoGrid.h"
+#include "CityPointStore.h"
+#include "MapPixelCurves.h"
+#include "MercatorProjector.h"
+#include "TaskPool.h"
+
+// incremental frames between full rebuilds, bounds the offset drift
+#define VISIBLESET_REBUILD_INTERVAL 300
+
+// fewest points a thread projects, a strip entering while panning stays on one
+#define VISIBLESET_GRAIN 16384
+
+class VisibleSet
+{
+public:
+
+    vector<int>         ids;        // point ids inside the window
+    MapPixelAttributes  pixels;     // x, y and elevation filled, one entry per id
+    ofVec2f             offset;     // add to pixels.x / y for the current projection
+
+    VisibleSet()
+    {
+        invalidate();
+    }
+
+    // Next update() rebuilds the whole set
+    //--------------------------------------------------------------
+    void invalidate()
+    {
+        m_valid      = false;
+        m_rebuilt    = false;
+        m_numAdded   = 0;
+        m_numRemoved = 0;
+        m_numFrames  = 0;
+        m_slotsStale = true;
+    }
+
+    // Window is lat +- latRange, lon +- lonRange, half-open like GeoGrid::query.
+    // With a pool the projection of the new points is split over its threads.
+    //--------------------------------------------------------------
+    void update( const GeoGrid &grid, const CityPointStore &points, const MercatorProjector &projector,
+                 double lat, double lon, double latRange, double lonRange, TaskPool *pool = NULL )
+    {
+        double minLat = lat - latRange, maxLat = lat + latRange;
+        double minLon = lon - lonRange, maxLon = lon + lonRange;
+
+        float dx = 0, dy = 0;
+        bool incremental = m_valid &&
+                           m_numFrames < VISIBLESET_REBUILD_INTERVAL &&
+                           latRange == m_latRange && lonRange == m_lonRange &&
+                           fabs( lat - m_lat ) < latRange * 0.5 &&
+                           fabs( lon - m_lon ) < lonRange * 0.5 &&
+                           projector.getTranslation( m_projector, dx, dy );
+
+        m_numAdded   = 0;
+        m_numRemoved = 0;
+
+        if ( incremental )
+        {
+            m_rebuilt = false;
+            m_numFrames++;
+
+            // the pan since the rebuild, kept positions stay as they are
+            m_offsetX += dx;
+            m_offsetY += dy;
+
+            // leaving strips - the old latitude rows over the full old width,
+            // then the old longitude columns over the latitudes both windows share
+            double oldMinLat = m_lat - latRange, oldMaxLat = m_lat + latRange;
+            double oldMinLon = m_lon - lonRange, oldMaxLon = m_lon + lonRange;
+
+            double sharedMinLat = std::max( minLat, oldMinLat );
+            double sharedMaxLat = std::min( maxLat, oldMaxLat );
+
+            m_leaving.clear();
+            if ( minLat > oldMinLat )
+                grid.query( oldMinLat, minLat, oldMinLon, oldMaxLon, m_leaving );
+            else if ( maxLat < oldMaxLat )
+                grid.query( maxLat, oldMaxLat, oldMinLon, oldMaxLon, m_leaving );
+
+            if ( minLon > oldMinLon )
+                grid.query( sharedMinLat, sharedMaxLat, oldMinLon, minLon, m_leaving );
+            else if ( maxLon < oldMaxLon )
+                grid.query( sharedMinLat, sharedMaxLat, maxLon, oldMaxLon, m_leaving );
+
+            // the last point fills the slot of each one that left
+            size_t kept = ids.size();
+            for (size_t i = 0; i < m_leaving.size(); i++)
+            {
+                int slot = m_slot[ m_leaving[i] ];
+                if ( slot < 0 )
+                    continue;
+
+                kept--;
+                ids[slot]              = ids[kept];
+                pixels.x[slot]         = pixels.x[kept];
+                pixels.y[slot]         = pixels.y[kept];
+                pixels.elevation[slot] = pixels.elevation[kept];
+
+                m_slot[ ids[slot] ]     = slot;
+                m_slot[ m_leaving[i] ]  = -1;
+            }
+            m_numRemoved = ids.size() - kept;
+            ids.resize( kept );
+
+            // entering strips - the new latitude rows over the full new width,
+            // then the new longitude columns over the shared latitudes
+            if ( maxLat > oldMaxLat )
+                grid.query( oldMaxLat, maxLat, minLon, maxLon, ids );
+            else if ( minLat < oldMinLat )
+                grid.query( minLat, oldMinLat, minLon, maxLon, ids );
+
+            if ( maxLon > oldMaxLon )
+                grid.query( sharedMinLat, sharedMaxLat, oldMaxLon, maxLon, ids );
+            else if ( minLon < oldMinLon )
+                grid.query( sharedMinLat, sharedMaxLat, minLon, oldMinLon, ids );
+
+            m_numAdded = ids.size() - kept;
+            for (size_t i = kept; i < ids.size(); i++)
+                m_slot[ ids[i] ] = i;
+
+            fill( points, projector, kept, pool );
+        }
+        else
+        {
+            m_rebuilt = true;
+            m_numFrames = 0;
+
+            m_offsetX = 0;
+            m_offsetY = 0;
+
+            // only the slots of the old ids are set, unless the points changed
+            if ( m_slotsStale || m_slot.size() != points.size() )
+                m_slot.assign( points.size(), -1 );
+            else
+                for (size_t i = 0; i < ids.size(); i++)
+                    m_slot[ ids[i] ] = -1;
+            m_slotsStale = false;
+
+            m_numRemoved = ids.size();
+            ids.clear();
+            grid.query( minLat, maxLat, minLon, maxLon, ids );
+            m_numAdded = ids.size();
+
+            for (size_t i = 0; i < ids.size(); i++)
+                m_slot[ ids[i] ] = i;
+
+            fill( points, projector, 0, pool );
+        }
+
+        m_valid     = true;
+        m_lat       = lat;
+        m_lon       = lon;
+        m_latRange  = latRange;
+        m_lonRange  = lonRange;
+        m_projector = projector;
+        offset.set( m_offsetX, m_offsetY );
+    }
+
+    //--------------------------------------------------------------
+    size_t size() const
+        { return ids.size(); }
+
+    // What the last update() did
+    //--------------------------------------------------------------
+    bool wasRebuilt() const
+        { return m_rebuilt; }
+
+    //--------------------------------------------------------------
+    size_t getNumAdded() const
+        { return m_numAdded; }
+
+    //--------------------------------------------------------------
+    size_t getNumRemoved() const
+        { return m_numRemoved; }
+
+private:
+
+    // Projects and gathers elevations of the ids from begin on, positions
+    // without the offset like the points that stay
+    //--------------------------------------------------------------
+    void fill( const CityPointStore &points, const MercatorProjector &projector, size_t begin, TaskPool *pool )
+    {
+        pixels.resize( ids.size() );
+        if ( begin >= ids.size() )
+            return;
+
+        TaskRange range = [&]( size_t from, size_t to )
+        {
+            projector.project( points.longitude.data(), points.mercatorY.data(),
+                               ids.data() + from, to - from,
+                               pixels.x.data() + from, pixels.y.data() + from );
+
+            for (size_t i = from; i < to; i++)
+            {
+                pixels.x[i]        -= m_offsetX;
+                pixels.y[i]        -= m_offsetY;
+                pixels.elevation[i] = points.elevation[ ids[i] ];
+            }
+        };
+
+        if ( pool )
+            pool->parallelFor( "viewport scan", ids.size() - begin, VISIBLESET_GRAIN,
+                               [&]( size_t from, size_t to ) { range( begin + from, begin + to ); } );
+        else
+            range( begin, ids.size() );
+    }
+
+    bool                m_valid;
+    bool                m_rebuilt;
+    double              m_lat;          // window center of the last update
+    double              m_lon;
+    double              m_latRange;
+    double              m_lonRange;
+    MercatorProjector   m_projector;    // projection of the last update
+    int                 m_numFrames;    // incremental updates since the last rebuild
+    double              m_offsetX;      // pan since the last rebuild
+    double              m_offsetY;
+
+    vector<int>         m_slot;         // index into ids by point id, -1 outside
+    bool                m_slotsStale;   // ids may be of other points
+    vector<int>         m_leaving;
+
+    size_t              m_numAdded;
+    size_t              m_numRemoved;
+};
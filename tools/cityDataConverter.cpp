@@ -0,0 +1,53 @@
+//
+//  cityDataConverter.cpp
+//
+//  3/26/14.
+//
+//
+//  Offline converter from the cityData / elevationData text files
+//  to the binary city data file the app maps at startup.
+//  Build as a command line openFrameworks project with the app sources
+//  on the include path.
+//
+//  usage: cityDataConverter <cityData> <elevationData> <output>
+
+#include "ofMain.h"
+#include "CityDataStructures.h"
+#include "CityPointStore.h"
+#include "GeoGrid.h"
+#include "CsvIngest.h"
+#include "StreetViewImageStore.h"
+#include "Utils.h"
+#include "CityDataFile.h"
+
+//--------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    if ( argc != 4 )
+    {
+        cout << "usage: cityDataConverter <cityData> <elevationData> <output>" << endl;
+        return 1;
+    }
+
+    // arguments are used as given, not relative to bin/data
+    ofSetDataPathRoot( "" );
+
+    CityPointStore points;
+    Utils::loadColors( points, argv[1] );
+    Utils::loadElevations( points, argv[2] );
+
+    GeoGrid grid;
+    grid.build( points.latitude, points.longitude );
+
+    if ( !CityDataFile::save( points, grid, argv[3] ) )
+    {
+        cout << "could not write " << argv[3] << endl;
+        return 1;
+    }
+
+    cout << points.size() << " points, "
+         << points.getNames().size() << " names, "
+         << grid.getNumCells() << " grid cells written to " << argv[3] << endl;
+
+    return 0;
+}
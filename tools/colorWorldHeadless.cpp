@@ -0,0 +1,69 @@
+//
+//  colorWorldHeadless.cpp
+//
+//  3/26/14.
+//
+//
+//  The app without a window or GL - setup, then update and compute for a
+//  number of frames, with per stage timings in the log. For machines with
+//  no GPU. Build as a command line openFrameworks project with the app
+//  sources on the include path, next to the app's bin/data.
+//  Set LEAP_REPLAY and LEAP_REPLAY_FAST for recorded input instead of none.
+//  --benchmarks runs the synthetic benchmarks after the frames, about half
+//  a minute; STREETVIEW_URL adds the fetch benchmark against a stand-in.
+//  Every heap allocation is counted for the benchmarks that report them.
+//
+//  usage: colorWorldHeadless [frames] [--benchmarks]
+
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ColorWorld.h"
+
+// Counts for Benchmarks::heapAllocations(), the array and sized forms
+// end up here and in the delete below
+//--------------------------------------------------------------
+void* operator new( size_t size )
+{
+    Benchmarks::heapAllocations()++;
+
+    void *memory = malloc( size ? size : 1 );
+    if ( !memory )
+        throw std::bad_alloc();
+    return memory;
+}
+
+//--------------------------------------------------------------
+void operator delete( void *memory ) noexcept
+{
+    free( memory );
+}
+
+//--------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    int  frames     = 600;
+    bool benchmarks = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if ( string( argv[i] ) == "--benchmarks" )
+            benchmarks = true;
+        else
+            frames = atoi( argv[i] );
+    }
+
+    if ( frames <= 0 )
+    {
+        cout << "usage: colorWorldHeadless [frames] [--benchmarks]" << endl;
+        return 1;
+    }
+
+    // the window size the app lays its frame out for
+    ofSetupOpenGL( new ofAppNoWindow(), 1024, 768, OF_WINDOW );
+
+    ColorWorld app;
+    app.runHeadless( frames );
+    if ( benchmarks )
+        app.runBenchmarks();
+
+    return 0;
+}
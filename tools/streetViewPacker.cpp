@@ -0,0 +1,94 @@
+//
+//  streetViewPacker.cpp
+//
+//  3/26/14.
+//
+//
+//  Offline packer from the streetViewMap_<lat>_<lon> image files listed
+//  in cityData to the street view atlas the app maps in offline mode.
+//  Build as a command line openFrameworks project with the app sources
+//  on the include path, run it from bin/data next to the images.
+//
+//  usage: streetViewPacker <cityData> <thumbnail size> <output>
+
+#include "ofMain.h"
+#include "CityPointStore.h"
+#include "CsvIngest.h"
+#include "StreetViewAtlas.h"
+
+//--------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    if ( argc != 4 )
+    {
+        cout << "usage: streetViewPacker <cityData> <thumbnail size> <output>" << endl;
+        return 1;
+    }
+
+    // arguments are used as given, not relative to bin/data
+    ofSetDataPathRoot( "" );
+
+    int size = atoi( argv[2] );
+    if ( size <= 0 )
+    {
+        cout << "bad thumbnail size " << argv[2] << endl;
+        return 1;
+    }
+
+    ofBuffer file = ofBufferFromFile( argv[1] );
+    const char *text = file.getBinaryBuffer();
+
+    vector<CsvRow> rows;
+    CsvIngest::parse( file, rows, argv[1] );
+
+    vector<StreetViewAtlasEntry> entries;
+    vector<unsigned char>        pixels;
+    size_t                       missing = 0;
+
+    ofPixels image;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const CsvRow &row = rows[i];
+        if ( row.fieldCount < 2 )
+            continue;
+
+        // file names use the coordinates as written in the data file, like Utils::loadImages
+        string path = "streetViewMap_"
+                    + string( text + row.fieldStart[0], row.fieldLength[0] )
+                    + "_"
+                    + string( text + row.fieldStart[1], row.fieldLength[1] );
+
+        if ( !ofLoadImage( image, path ) )
+        {
+            missing++;
+            continue;
+        }
+
+        // the color is sampled from the full size image, like the app always did
+        ofColor color = image.getColor( 65, 65 );
+
+        StreetViewAtlasEntry entry;
+        entry.latitude  = row.lat;
+        entry.longitude = row.lon;
+        entry.color[0]  = color.r;
+        entry.color[1]  = color.g;
+        entry.color[2]  = color.b;
+        entry.color[3]  = color.a;
+        entries.push_back( entry );
+
+        image.setImageType( OF_IMAGE_COLOR );
+        image.resize( size, size );
+        pixels.insert( pixels.end(), image.getPixels(), image.getPixels() + size * size * 3 );
+    }
+
+    if ( !StreetViewAtlas::save( entries, pixels, size, argv[3] ) )
+    {
+        cout << "could not write " << argv[3] << endl;
+        return 1;
+    }
+
+    cout << entries.size() << " thumbnails of " << size << "x" << size << " written to " << argv[3]
+         << ", " << missing << " images missing" << endl;
+
+    return 0;
+}
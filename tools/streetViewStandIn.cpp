@@ -0,0 +1,150 @@
+//
+//  streetViewStandIn.cpp
+//
+//  3/26/14.
+//
+//
+//  Local stand-in for the street view API, to test StreetViewFetcher
+//  without the network. Answers every GET with a canned 50x50 BMP after
+//  the given latency. The color is derived from the location parameter,
+//  so different locations give different palettes.
+//  Plain C++ and POSIX sockets, no openFrameworks needed:
+//
+//      c++ -std=c++11 -O2 -pthread streetViewStandIn.cpp -o streetViewStandIn
+//
+//  usage: streetViewStandIn <port> <latency ms>
+//  then point the app at http://localhost:<port>/streetview
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define IMAGE_SIZE 50
+
+//--------------------------------------------------------------
+static void putLE( std::vector<unsigned char> &out, unsigned value, int bytes )
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back( ( value >> ( 8 * i ) ) & 0xff );
+}
+
+// 24 bit BMP filled with one color
+//--------------------------------------------------------------
+static std::vector<unsigned char> makeImage( unsigned char r, unsigned char g, unsigned char b )
+{
+    const int rowSize  = ( IMAGE_SIZE * 3 + 3 ) & ~3;
+    const int dataSize = rowSize * IMAGE_SIZE;
+
+    std::vector<unsigned char> bmp;
+    bmp.push_back( 'B' );
+    bmp.push_back( 'M' );
+    putLE( bmp, 54 + dataSize, 4 );
+    putLE( bmp, 0, 4 );
+    putLE( bmp, 54, 4 );
+
+    putLE( bmp, 40, 4 );
+    putLE( bmp, IMAGE_SIZE, 4 );
+    putLE( bmp, IMAGE_SIZE, 4 );
+    putLE( bmp, 1, 2 );
+    putLE( bmp, 24, 2 );
+    putLE( bmp, 0, 4 );
+    putLE( bmp, dataSize, 4 );
+    putLE( bmp, 2835, 4 );
+    putLE( bmp, 2835, 4 );
+    putLE( bmp, 0, 4 );
+    putLE( bmp, 0, 4 );
+
+    for (int y = 0; y < IMAGE_SIZE; y++)
+    {
+        for (int x = 0; x < IMAGE_SIZE; x++)
+        {
+            bmp.push_back( b );
+            bmp.push_back( g );
+            bmp.push_back( r );
+        }
+        for (int p = IMAGE_SIZE * 3; p < rowSize; p++)
+            bmp.push_back( 0 );
+    }
+
+    return bmp;
+}
+
+//--------------------------------------------------------------
+static void serve( int client, int latency )
+{
+    char request[4096];
+    ssize_t length = recv( client, request, sizeof(request) - 1, 0 );
+    if ( length <= 0 )
+    {
+        close( client );
+        return;
+    }
+    request[length] = 0;
+
+    // color from the location=lat,lon parameter
+    unsigned hash = 2166136261u;
+    const char *location = strstr( request, "location=" );
+    for (const char *c = location; c && *c && *c != '&' && *c != ' '; c++)
+        hash = ( hash ^ (unsigned char)*c ) * 16777619u;
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( latency ) );
+
+    std::vector<unsigned char> image = makeImage( hash & 0xff, ( hash >> 8 ) & 0xff, ( hash >> 16 ) & 0xff );
+
+    char header[256];
+    int headerLength = snprintf( header, sizeof(header),
+                                 "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: image/bmp\r\n"
+                                 "Content-Length: %d\r\n"
+                                 "Connection: close\r\n\r\n", (int)image.size() );
+
+    send( client, header, headerLength, 0 );
+    send( client, image.data(), image.size(), 0 );
+    close( client );
+}
+
+//--------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    if ( argc != 3 )
+    {
+        printf( "usage: streetViewStandIn <port> <latency ms>\n" );
+        return 1;
+    }
+
+    int port    = atoi( argv[1] );
+    int latency = atoi( argv[2] );
+
+    int server = socket( AF_INET, SOCK_STREAM, 0 );
+    int reuse  = 1;
+    setsockopt( server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse) );
+
+    sockaddr_in address;
+    memset( &address, 0, sizeof(address) );
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port        = htons( port );
+
+    if ( bind( server, (sockaddr*)&address, sizeof(address) ) != 0 || listen( server, 64 ) != 0 )
+    {
+        perror( "streetViewStandIn" );
+        return 1;
+    }
+
+    printf( "serving 50x50 images on http://localhost:%d/streetview, %dms latency\n", port, latency );
+
+    while ( true )
+    {
+        int client = accept( server, NULL, NULL );
+        if ( client >= 0 )
+            std::thread( serve, client, latency ).detach();
+    }
+}